@@ -79,6 +79,14 @@ namespace ClassGame {
                         ImGui::Text("%s", stateString.substr(y*stride,stride).c_str());
                     }
                     ImGui::Text("Current Board State: %s", game->stateString().c_str());
+                    std::string evaluation = game->evaluationString();
+                    if (!evaluation.empty()) {
+                        ImGui::Text("Evaluation: %s", evaluation.c_str());
+                    }
+                    if (game->gameHasAI()) {
+                        ImGui::SliderInt("AI Threads", &game->_gameOptions.AIThreads, 1, 64);
+                        ImGui::SliderInt("AI Move Time (ms)", &game->_gameOptions.AIMoveTime, 0, 30000);
+                    }
                 }
                 ImGui::End();
 
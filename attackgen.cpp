@@ -0,0 +1,118 @@
+//
+// Build-time generator for the slider attack tables in MagicBitboards.h.
+//
+// usage: attackgen <output file>
+//
+// Writes SliderAttackTables.inc: every rook and bishop attack set, once laid out for magic
+// multiplication (MagicAttackTable) and once for PEXT indexing (RookPextAttackTable and
+// BishopPextAttackTable, x86 only), as const arrays the engine compiles in. Run by CMake before anything that includes
+// MagicBitboards.h is built.
+//
+
+#define MAGIC_BITBOARDS_GENERATOR
+#include "classes/MagicBitboards.h"
+#include <cstdio>
+#include <vector>
+
+// Packs the bits of b selected by mask into the low bits of the result, as PEXT does. The
+// generator runs on the build machine, which may not have BMI2, so it is done a bit at a time.
+static uint64_t extractBits(uint64_t b, uint64_t mask)
+{
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask; mask &= mask - 1, bit <<= 1)
+    {
+        if (b & mask & (0 - mask)) result |= bit;
+    }
+    return result;
+}
+
+// Fills one piece type's attack sets into table, laid out for magic multiplication
+static void fillMagicAttacks(uint64_t* table, const int* sizes, const uint64_t* masks, const uint64_t* magicNumbers,
+                             const int* shifts, uint64_t (*slowAttacks)(int, uint64_t))
+{
+    for (int square = 0; square < 64; square++)
+    {
+        int bits = countOnes(masks[square]);
+        for (int i = 0; i < 1 << bits; i++)
+        {
+            uint64_t subset = indexToUint64(i, bits, masks[square]);
+            table[(subset * magicNumbers[square]) >> shifts[square]] = slowAttacks(square, subset);
+        }
+        table += sizes[square];
+    }
+}
+
+// Fills one piece type's attack sets into table, laid out for PEXT indexing. With compress, each
+// attack set is stored as the bits of the piece's empty-board rays it keeps (14 squares at most
+// for a rook, so 16 bits), which PDEP puts back.
+template <typename Entry>
+static void fillPextAttacks(Entry* table, const uint64_t* masks, uint64_t (*slowAttacks)(int, uint64_t), bool compress)
+{
+    for (int square = 0; square < 64; square++)
+    {
+        int bits = countOnes(masks[square]);
+        uint64_t rays = slowAttacks(square, 0);
+        for (int i = 0; i < 1 << bits; i++)
+        {
+            // indexToUint64 deposits the bits of i into the mask, so i is the subset's PEXT index
+            uint64_t attacks = slowAttacks(square, indexToUint64(i, bits, masks[square]));
+            table[i] = (Entry)(compress ? extractBits(attacks, rays) : attacks);
+        }
+        table += 1 << bits;
+    }
+}
+
+static void writeTable(FILE* file, const char* name, const char* size, const std::vector<uint64_t>& table)
+{
+    fprintf(file, "alignas(64) static const uint64_t %s[%s] = {\n", name, size);
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        fprintf(file, "%s0x%016llxULL,%s", i % 4 == 0 ? "  " : "", (unsigned long long)table[i], i % 4 == 3 ? "\n" : " ");
+    }
+    fprintf(file, "\n};\n\n");
+}
+
+static void writeTable(FILE* file, const char* name, const char* size, const std::vector<uint16_t>& table)
+{
+    fprintf(file, "alignas(64) static const uint16_t %s[%s] = {\n", name, size);
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        fprintf(file, "%s0x%04x,%s", i % 8 == 0 ? "  " : "", table[i], i % 8 == 7 ? "\n" : " ");
+    }
+    fprintf(file, "\n};\n\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <output file>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<uint64_t> magicTable(RAttackTableSize + BAttackTableSize);
+    fillMagicAttacks(magicTable.data(), RAttackSize, RMasks, RMagic, RShifts, ratt);
+    fillMagicAttacks(magicTable.data() + RAttackTableSize, BAttackSize, BMasks, BMagic, BShifts, batt);
+
+    std::vector<uint16_t> rookPextTable(RPextTableSize);
+    fillPextAttacks(rookPextTable.data(), RMasks, ratt, true);
+    std::vector<uint64_t> bishopPextTable(BPextTableSize);
+    fillPextAttacks(bishopPextTable.data(), BMasks, batt, false);
+
+    FILE* file = fopen(argv[1], "w");
+    if (!file)
+    {
+        fprintf(stderr, "attackgen: can't write %s\n", argv[1]);
+        return 1;
+    }
+    fprintf(file, "// Generated by attackgen from the masks and magics in MagicBitboards.h, do not edit\n\n");
+    writeTable(file, "MagicAttackTable", "RAttackTableSize + BAttackTableSize", magicTable);
+    // Only x86 has PEXT, so other builds leave that table out
+    fprintf(file, "#if defined(CPU_X86)\n");
+    writeTable(file, "RookPextAttackTable", "RPextTableSize", rookPextTable);
+    writeTable(file, "BishopPextAttackTable", "BPextTableSize", bishopPextTable);
+    fprintf(file, "#endif\n");
+    bool ok = fclose(file) == 0;
+    if (!ok) fprintf(stderr, "attackgen: can't write %s\n", argv[1]);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+//
+// Headless search benchmark for the chess engine.
+//
+// usage: bench <depth> ["<fen>"] [--hash <MB>] [--threads <N>] [--time <ms>] [--nnue <file>] [--bitbases <file>] [--syzygy <path>]
+//
+// Runs the same search Chess::updateAI uses on the given position (start position if no FEN is
+// given) and prints depth, score, nodes, nodes per second and the principal variation after each
+// iteration, followed by each thread's node count. With --time the search stops after that many
+// milliseconds, playing the deepest completed iteration's move, as the game's AI does. With --nnue the search evaluates with that network
+// instead of the piece-square tables. The KPK, KRK and KQK bitbases are generated first, or mapped
+// from the --bitbases cache file if an earlier run wrote one there. With --syzygy the search probes
+// the Syzygy tables in that directory (several separated by ':'). Links only the bitboard code in classes/, no ImGui or GLFW.
+//
+
+#include "classes/Search.h"
+#include "classes/Bitbases.h"
+#include "classes/Tablebases.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+static const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+int main(int argc, char** argv)
+{
+    int depth = 8;
+    std::string fen = StartFEN;
+    size_t hashMB = 64;
+    int threads = 1;
+    int timeLimit = 0;
+    const char* networkPath = nullptr;
+    const char* bitbasePath = "";
+    const char* syzygyPath = "";
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+        {
+            hashMB = (size_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+        {
+            timeLimit = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--nnue") == 0 && i + 1 < argc)
+        {
+            networkPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--bitbases") == 0 && i + 1 < argc)
+        {
+            bitbasePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--syzygy") == 0 && i + 1 < argc)
+        {
+            syzygyPath = argv[++i];
+        }
+        else if (positional == 0)
+        {
+            depth = atoi(argv[i]);
+            positional++;
+        }
+        else if (positional == 1)
+        {
+            fen = argv[i];
+            positional++;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s <depth> [\"<fen>\"] [--hash <MB>] [--threads <N>] [--time <ms>] [--nnue <file>] [--bitbases <file>] [--syzygy <path>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Position position;
+    if (depth < 1 || !position.setFEN(fen))
+    {
+        fprintf(stderr, "usage: %s <depth> [\"<fen>\"] [--hash <MB>] [--threads <N>] [--time <ms>] [--nnue <file>] [--bitbases <file>] [--syzygy <path>]\n", argv[0]);
+        return 1;
+    }
+
+    NNUE::Network network;
+    if (networkPath)
+    {
+        if (!network.load(networkPath))
+        {
+            fprintf(stderr, "%s\n", network.getError().c_str());
+            return 1;
+        }
+        position.setNetwork(&network);
+    }
+
+    Bitbases::init(bitbasePath);
+    const Bitbases::Info& bitbases = Bitbases::getInfo();
+    if (!bitbases.error.empty()) fprintf(stderr, "%s\n", bitbases.error.c_str());
+
+    if (syzygyPath[0] && !Tablebases::isAvailable()) fprintf(stderr, "--syzygy ignored: configure with -DSYZYGY=ON to build the prober\n");
+    int tables = Tablebases::init(syzygyPath);
+
+    MoveGenerator moveGenerator;
+    TranspositionTable transpositionTable;
+    transpositionTable.resize(hashMB);
+    Search search(moveGenerator, transpositionTable);
+    search.setThreads(threads);
+    search.setTimeLimit(timeLimit);
+
+    printf("FEN: %s\nDepth: %d\nThreads: %d\nHash: %zu MB\nSlider attacks: %s\n", fen.c_str(), depth, search.getThreads(),
+           transpositionTable.getSizeMB(), MoveGenerator::sliderAttackBackend());
+    if (networkPath) printf("Evaluation: %s (%s)\n\n", networkPath, NNUE::Network::backend());
+    else printf("Evaluation: piece-square tables\n");
+    if (bitbases.fromCache) printf("Bitbases: %zu KB mapped from %s in %.1f ms\n\n", bitbases.bytes / 1024, bitbasePath, bitbases.milliseconds);
+    else printf("Bitbases: %zu KB generated in %.1f ms (%d passes)\n", bitbases.bytes / 1024, bitbases.milliseconds, bitbases.passes);
+    if (tables > 0) printf("Tablebases: %d Syzygy tables up to %d pieces in %s\n\n", tables, Tablebases::maxPieces(), syzygyPath);
+    else printf("Tablebases: none\n\n");
+
+    BitMove bestMove = search.think(position, depth,
+        [](const SearchInfo& info)
+        {
+            printf("%s\n", info.toString().c_str());
+            printf("  %s\n", info.threadNodesString().c_str());
+            fflush(stdout);
+        }
+    );
+
+    printf("\nBest move: %s\n", bestMove.isNull() ? "(none)" : bestMove.toString().c_str());
+    return 0;
+}
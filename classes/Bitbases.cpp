@@ -0,0 +1,303 @@
+#include "Bitbases.h"
+#include "MoveGenerator.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Bitbases
+{
+
+// An index is the side to move (white being the strong side), the strong king, the weak king and
+// the piece. The pawn only ever stands on 24 squares, files a to d and ranks 2 to 7.
+constexpr int PieceSquares[ENDINGS] = { 24, 64, 64 };
+constexpr int PieceTypes[ENDINGS] = { Pawn, Rook, Queen };
+constexpr size_t positions(int ending) { return (size_t)2 * 64 * 64 * PieceSquares[ending]; }
+constexpr size_t tableWords(int ending) { return positions(ending) / 64; }
+
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t CACHE_SIZE = HEADER_SIZE + (tableWords(KPK) + tableWords(KRK) + tableWords(KQK)) * sizeof(uint64_t);
+static const char Magic[8] = { 'B', 'I', 'T', 'B', 'A', 'S', 'E', '1' };
+
+// Results combine with |: a side wins if any move wins, and loses only if every move loses.
+// Positions that can't happen are 0 so they never change what they are combined with.
+enum Result : uint8_t
+{
+    INVALID = 0,
+    UNKNOWN = 1,
+    DRAW = 2,
+    WIN = 4
+};
+
+static const uint64_t* Tables[ENDINGS];
+static std::vector<uint64_t> Generated;
+static MappedFile CacheFile;
+static Info BuildInfo;
+static std::once_flag Initialized;
+static std::atomic<bool> Ready(false);
+
+static inline size_t index(int ending, int sideToMove, int strongKing, int weakKing, int pieceSquare)
+{
+    int piece = ending == KPK ? ((pieceSquare >> 3) - 1) * 4 + (pieceSquare & 7) : pieceSquare;
+    return (size_t)sideToMove | (size_t)strongKing << 1 | (size_t)weakKing << 7 | (size_t)piece << 13;
+}
+
+static inline void decode(int ending, size_t i, int& sideToMove, int& strongKing, int& weakKing, int& pieceSquare)
+{
+    sideToMove = (int)(i & 1);
+    strongKing = (int)(i >> 1) & 63;
+    weakKing = (int)(i >> 7) & 63;
+    int piece = (int)(i >> 13);
+    pieceSquare = ending == KPK ? ((piece >> 2) + 1) * 8 + (piece & 3) : piece;
+}
+
+static inline int distance(int a, int b)
+{
+    return std::max(std::abs((a & 7) - (b & 7)), std::abs((a >> 3) - (b >> 3)));
+}
+
+static inline uint64_t kingAttacks(int square)
+{
+    return MoveGenerator::pieceAttacks(King, square, 0ULL);
+}
+
+// Squares the strong side's pawn, rook or queen attacks
+static inline uint64_t pieceAttacks(int ending, int square, uint64_t occupied)
+{
+    if (ending == KPK)
+    {
+        constexpr uint64_t FileA = 0x0101010101010101ULL;
+        uint64_t pawn = 1ULL << square;
+        return ((pawn << 7) & ~(FileA << 7)) | ((pawn << 9) & ~FileA);
+    }
+    return MoveGenerator::pieceAttacks(PieceTypes[ending], square, occupied);
+}
+
+//
+// Everything that can be decided without looking at the positions a move leads to: positions
+// that can't happen, mates, stalemates, the piece being taken, and a pawn queening safely
+//
+static uint8_t classify(int ending, size_t i)
+{
+    int sideToMove, strongKing, weakKing, pieceSquare;
+    decode(ending, i, sideToMove, strongKing, weakKing, pieceSquare);
+    uint64_t weakKingBit = 1ULL << weakKing;
+    if (strongKing == weakKing || strongKing == pieceSquare || weakKing == pieceSquare || (kingAttacks(strongKing) & weakKingBit)) return INVALID;
+
+    uint64_t occupied = (1ULL << strongKing) | (1ULL << pieceSquare) | weakKingBit;
+    bool check = (pieceAttacks(ending, pieceSquare, occupied) & weakKingBit) != 0;
+    if (sideToMove == WHITE)
+    {
+        // The side that just moved can't have left its king in check
+        if (check) return INVALID;
+        if (ending == KPK && (pieceSquare >> 3) == 6)
+        {
+            int queening = pieceSquare + 8;
+            if (queening != strongKing && queening != weakKing && (distance(weakKing, queening) > 1 || distance(strongKing, queening) == 1)) return WIN;
+        }
+        return UNKNOWN;
+    }
+
+    // The weak king can't step along a slider's line away from it, so look through the king
+    uint64_t guarded = kingAttacks(strongKing) | pieceAttacks(ending, pieceSquare, occupied & ~weakKingBit);
+    uint64_t escapes = kingAttacks(weakKing) & ~guarded;
+    if (escapes & (1ULL << pieceSquare)) return DRAW;
+    if (!escapes) return check ? WIN : DRAW;
+    return UNKNOWN;
+}
+
+// What an undecided position is worth given what is known so far about the positions after each move
+static uint8_t resolve(int ending, const std::vector<std::atomic<uint8_t>>& results, size_t i)
+{
+    int sideToMove, strongKing, weakKing, pieceSquare;
+    decode(ending, i, sideToMove, strongKing, weakKing, pieceSquare);
+    auto result = [&](int side, int strong, int weak, int piece) { return results[index(ending, side, strong, weak, piece)].load(std::memory_order_relaxed); };
+
+    uint8_t r = INVALID;
+    if (sideToMove == WHITE)
+    {
+        // Moves onto an occupied or attacked square lead to INVALID entries, which don't count
+        Bitboard(kingAttacks(strongKing)).forEachBit([&](int to) { r |= result(BLACK, to, weakKing, pieceSquare); });
+        if (ending == KPK)
+        {
+            // Queening was settled by classify, so only pushes that stay on the board are left
+            int rank = pieceSquare >> 3;
+            if (rank < 6) r |= result(BLACK, strongKing, weakKing, pieceSquare + 8);
+            if (rank == 1 && pieceSquare + 8 != strongKing && pieceSquare + 8 != weakKing) r |= result(BLACK, strongKing, weakKing, pieceSquare + 16);
+        }
+        else
+        {
+            uint64_t occupied = (1ULL << strongKing) | (1ULL << weakKing);
+            Bitboard(pieceAttacks(ending, pieceSquare, occupied)).forEachBit([&](int to) { r |= result(BLACK, strongKing, weakKing, to); });
+        }
+        return r & WIN ? WIN : r & UNKNOWN ? UNKNOWN : DRAW;
+    }
+
+    Bitboard(kingAttacks(weakKing)).forEachBit([&](int to) { r |= result(WHITE, strongKing, to, pieceSquare); });
+    return r & DRAW ? DRAW : r & UNKNOWN ? UNKNOWN : WIN;
+}
+
+// Runs work over every index, split into one contiguous range per core
+template <typename Work>
+static void parallelFor(size_t count, Work work)
+{
+    int threads = std::max(1, (int)std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+    {
+        size_t begin = count * t / threads;
+        size_t end = count * (t + 1) / threads;
+        pool.emplace_back([begin, end, &work] { for (size_t i = begin; i < end; i++) work(i); });
+    }
+    for (std::thread& thread : pool) thread.join();
+}
+
+//
+// Marks every position that can be decided straight away, then keeps passing over the undecided
+// ones until a pass decides nothing more. Results only ever go from UNKNOWN to DRAW or WIN, so
+// threads can read entries others are writing and still end up at the same tables, just sooner.
+// Whatever is still undecided at the end can't be won.
+//
+static int generate(int ending, uint64_t* table)
+{
+    size_t count = positions(ending);
+    std::vector<std::atomic<uint8_t>> results(count);
+    parallelFor(count, [&](size_t i) { results[i].store(classify(ending, i), std::memory_order_relaxed); });
+
+    int passes = 0;
+    std::atomic<bool> changed(true);
+    while (changed.load())
+    {
+        changed.store(false);
+        passes++;
+        parallelFor(count, [&](size_t i) {
+            if (results[i].load(std::memory_order_relaxed) != UNKNOWN) return;
+            uint8_t result = resolve(ending, results, i);
+            if (result == UNKNOWN) return;
+            results[i].store(result, std::memory_order_relaxed);
+            changed.store(true, std::memory_order_relaxed);
+        });
+    }
+
+    std::fill(table, table + tableWords(ending), 0ULL);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (results[i].load(std::memory_order_relaxed) == WIN) table[i >> 6] |= 1ULL << (i & 63);
+    }
+    return passes;
+}
+
+static bool mapCache(const std::string& path)
+{
+    if (!CacheFile.map(path))
+    {
+        BuildInfo.error = CacheFile.getError();
+        return false;
+    }
+    uint32_t sizes[ENDINGS];
+    memcpy(sizes, CacheFile.getData() + sizeof(Magic), sizeof(sizes));
+    if (CacheFile.getSize() != CACHE_SIZE || memcmp(CacheFile.getData(), Magic, sizeof(Magic)) != 0 ||
+        sizes[KPK] != positions(KPK) || sizes[KRK] != positions(KRK) || sizes[KQK] != positions(KQK))
+    {
+        BuildInfo.error = path + " is not a bitbase cache, generating the tables again";
+        CacheFile.unmap();
+        return false;
+    }
+
+    const uint64_t* table = (const uint64_t*)(CacheFile.getData() + HEADER_SIZE);
+    for (int ending = KPK; ending < ENDINGS; ending++)
+    {
+        Tables[ending] = table;
+        table += tableWords(ending);
+    }
+    return true;
+}
+
+static void writeCache(const std::string& path)
+{
+    char header[HEADER_SIZE] = {};
+    uint32_t sizes[ENDINGS] = { (uint32_t)positions(KPK), (uint32_t)positions(KRK), (uint32_t)positions(KQK) };
+    memcpy(header, Magic, sizeof(Magic));
+    memcpy(header + sizeof(Magic), sizes, sizeof(sizes));
+
+    // Written under another name and renamed, so another process never maps half a file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(header, sizeof(header));
+        file.write((const char*)Generated.data(), Generated.size() * sizeof(uint64_t));
+        if (!file)
+        {
+            BuildInfo.error = "can't write " + temporary;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) BuildInfo.error = "can't write " + path + " (" + error.message() + ")";
+}
+
+void init(const std::string& cachePath)
+{
+    std::call_once(Initialized, [&cachePath] {
+        auto start = std::chrono::steady_clock::now();
+        BuildInfo = Info();
+        BuildInfo.bytes = CACHE_SIZE - HEADER_SIZE;
+
+        BuildInfo.fromCache = !cachePath.empty() && std::filesystem::exists(cachePath) && mapCache(cachePath);
+        if (!BuildInfo.fromCache)
+        {
+            Generated.assign(BuildInfo.bytes / sizeof(uint64_t), 0ULL);
+            uint64_t* table = Generated.data();
+            for (int ending = KPK; ending < ENDINGS; ending++)
+            {
+                BuildInfo.passes += generate(ending, table);
+                Tables[ending] = table;
+                table += tableWords(ending);
+            }
+            if (!cachePath.empty()) writeCache(cachePath);
+        }
+
+        BuildInfo.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        Ready.store(true, std::memory_order_release);
+    });
+}
+
+bool isReady()
+{
+    return Ready.load(std::memory_order_acquire);
+}
+
+const Info& getInfo()
+{
+    return BuildInfo;
+}
+
+bool probe(Ending ending, int strongSide, int sideToMove, int strongKing, int weakKing, int pieceSquare)
+{
+    // Tables are stored with white as the strong side and, for KPK, the pawn on files a to d
+    int side = sideToMove == strongSide ? WHITE : BLACK;
+    if (strongSide == BLACK)
+    {
+        strongKing ^= 56;
+        weakKing ^= 56;
+        pieceSquare ^= 56;
+    }
+    if (ending == KPK && (pieceSquare & 7) > 3)
+    {
+        strongKing ^= 7;
+        weakKing ^= 7;
+        pieceSquare ^= 7;
+    }
+    size_t i = index(ending, side, strongKing, weakKing, pieceSquare);
+    return (Tables[ending][i >> 6] >> (i & 63)) & 1;
+}
+
+}
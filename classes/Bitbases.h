@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//
+// Win/draw bitbases for a king and one pawn, rook or queen against a bare king (KPK, KRK, KQK):
+// one bit per position saying whether the side with the extra material wins with best play. KPK
+// only needs pawns on files a to d, the rest are mirrored, so it takes 24 KB; KRK and KQK take
+// 64 KB each.
+//
+// The tables are worked out by retrograde analysis on every core, or mapped from a cache file an
+// earlier run wrote. They are read-only once built, so any number of threads can probe them.
+//
+namespace Bitbases
+{
+    enum Ending
+    {
+        KPK,
+        KRK,
+        KQK,
+        ENDINGS
+    };
+
+    // How the tables were built, for the log
+    struct Info
+    {
+        double milliseconds;
+        size_t bytes;
+        bool fromCache;
+        // Passes over every position until none changed, summed over the endings
+        int passes;
+        // Set if the cache file couldn't be read or written; the tables are fine either way
+        std::string error;
+    };
+
+    // Builds the tables the first time it is called, later calls return straight away. With a
+    // cache path the tables are mapped from that file if it holds them, and otherwise generated
+    // and written there for the next run.
+    void init(const std::string& cachePath = "");
+    bool isReady();
+    const Info& getInfo();
+
+    // True if strongSide (the side with the pawn, rook or queen) wins. Squares are as on the board.
+    bool probe(Ending ending, int strongSide, int sideToMove, int strongKing, int weakKing, int pieceSquare);
+}
@@ -3,7 +3,9 @@
 #ifdef _MSC_VER
 #include <intrin.h>
 #endif
+#include <cstdint>
 #include <iostream>
+#include <string>
 
 enum ChessPiece
 {
@@ -41,11 +43,25 @@ class Bitboard {
         }
     }
 
+    // Number of set bits
+    int countBits() const {
+        #if defined(_MSC_VER) && !defined(__clang__)
+            return (int)__popcnt64(_data);
+        #else
+            return __builtin_popcountll(_data);
+        #endif
+    }
+
     Bitboard& operator|=(const uint64_t other) {
         _data |= other;
         return *this;
     }
 
+    Bitboard& operator^=(const uint64_t other) {
+        _data ^= other;
+        return *this;
+    }
+
     void printBitboard() {
         std::cout << "\n  a b c d e f g h\n";
         for (int rank = 7; rank >= 0; rank--) {
@@ -81,19 +97,65 @@ private:
 
 };
 
+// The 4 flag bits of a BitMove. Bit 2 marks captures and bit 3 promotions, whose low two bits
+// are the piece promoted to (knight, bishop, rook, queen).
+enum MoveFlags
+{
+    MOVE_QUIET = 0,
+    MOVE_DOUBLE_PUSH = 1,
+    MOVE_KING_CASTLE = 2,
+    MOVE_QUEEN_CASTLE = 3,
+    MOVE_CAPTURE = 4,
+    MOVE_EN_PASSANT = 5,
+    MOVE_KNIGHT_PROMOTION = 8,
+    MOVE_BISHOP_PROMOTION = 9,
+    MOVE_ROOK_PROMOTION = 10,
+    MOVE_QUEEN_PROMOTION = 11,
+    MOVE_KNIGHT_PROMOTION_CAPTURE = 12,
+    MOVE_BISHOP_PROMOTION_CAPTURE = 13,
+    MOVE_ROOK_PROMOTION_CAPTURE = 14,
+    MOVE_QUEEN_PROMOTION_CAPTURE = 15
+};
+
+// A move packed into 16 bits: from and to squares (6 bits each) and 4 bits of MoveFlags
 struct BitMove {
-    uint8_t from;
-    uint8_t to;
-    uint8_t piece;
-    
-    BitMove(int from, int to, ChessPiece piece)
-        : from(from), to(to), piece(piece) { }
-        
-    BitMove() : from(0), to(0), piece(NoPiece) { }
-    
+    uint16_t from : 6;
+    uint16_t to : 6;
+    uint16_t flags : 4;
+
+    BitMove(int from, int to, int flags = MOVE_QUIET)
+        : from(from), to(to), flags(flags) { }
+
+    BitMove() : from(0), to(0), flags(MOVE_QUIET) { }
+
     bool operator==(const BitMove& other) const {
-        return from == other.from && 
-               to == other.to && 
-               piece == other.piece;
+        return toData() == other.toData();
+    }
+
+    // The 16 bits as one number, and back, for storing moves in the transposition table
+    uint16_t toData() const { return (uint16_t)(from | (to << 6) | (flags << 12)); }
+    static BitMove fromData(uint16_t data) { return BitMove(data & 63, (data >> 6) & 63, data >> 12); }
+
+    bool isCapture() const { return (flags & MOVE_CAPTURE) != 0; }
+    bool isPromotion() const { return (flags & MOVE_KNIGHT_PROMOTION) != 0; }
+    bool isCaptureOrPromotion() const { return (flags & (MOVE_CAPTURE | MOVE_KNIGHT_PROMOTION)) != 0; }
+    bool isCastle() const { return flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE; }
+    bool isEnPassant() const { return flags == MOVE_EN_PASSANT; }
+    ChessPiece promotionPiece() const { return (ChessPiece)(Knight + (flags & 3)); }
+
+    // A move from a square to itself stands for "no move"
+    bool isNull() const { return from == to; }
+
+    // Coordinate notation, e.g. "e2e4" or "e7e8q"
+    std::string toString() const {
+        std::string s;
+        s += (char)('a' + from % 8);
+        s += (char)('1' + from / 8);
+        s += (char)('a' + to % 8);
+        s += (char)('1' + to / 8);
+        if (isPromotion()) s += "nbrq"[flags & 3];
+        return s;
     }
-};
\ No newline at end of file
+};
+
+static_assert(sizeof(BitMove) == 2, "BitMove should pack into 16 bits");
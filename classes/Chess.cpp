@@ -1,36 +1,27 @@
 #include "Chess.h"
 #include "Logger.h"
-#include "MagicBitboards.h"
+#include "Evaluation.h"
+#include "Bitbases.h"
+#include "Tablebases.h"
 #include <limits>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <filesystem>
 
 Logger &logger = Logger::GetInstance();
 
 Chess::Chess()
+    : _search(_moveGenerator, _transpositionTable), _aiDone(false)
 {
     _grid = new Grid(8, 8);
-    initMagicBitboards();
-
-    for (int i = 0; i < 128; i++) _bitboardLookup[i] = 0;
-    _bitboardLookup['P'] = WHITE_PAWNS;
-    _bitboardLookup['N'] = WHITE_KNIGHTS;
-    _bitboardLookup['B'] = WHITE_BISHOPS;
-    _bitboardLookup['R'] = WHITE_ROOKS;
-    _bitboardLookup['Q'] = WHITE_QUEENS;
-    _bitboardLookup['K'] = WHITE_KING;
-    _bitboardLookup['p'] = BLACK_PAWNS;
-    _bitboardLookup['n'] = BLACK_KNIGHTS;
-    _bitboardLookup['b'] = BLACK_BISHOPS;
-    _bitboardLookup['r'] = BLACK_ROOKS;
-    _bitboardLookup['q'] = BLACK_QUEENS;
-    _bitboardLookup['k'] = BLACK_KING;
-    _bitboardLookup['0'] = EMPTY_SQUARES;
 }
 
 Chess::~Chess()
 {
+    stopAI();
     delete _grid;
-    cleanupMagicBitboards();
 }
 
 char Chess::pieceNotation(int x, int y) const
@@ -67,24 +58,63 @@ void Chess::setUpBoard()
     _gameOptions.rowX = 8;
     _gameOptions.rowY = 8;
 
+    // Search to AIDepthSearches plies, never deeper than AIMAXDepth
+    _gameOptions.AIDepthSearches = 5;
+    _gameOptions.AIMAXDepth = 12;
+    // One search thread per core (Lazy SMP), adjustable from the settings window
+    _gameOptions.AIThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    // Play the deepest completed iteration after two seconds at most
+    _gameOptions.AIMoveTime = 2000;
+    logger.Info(std::string("Slider attacks use ") + MoveGenerator::sliderAttackBackend());
+
+    // Evaluate with a network if one has been put in resources, otherwise with the piece-square tables
+    const char* networkPath = "resources/network.nnue";
+    if (std::filesystem::exists(networkPath))
+    {
+        if (_network.load(networkPath)) logger.Info(std::string("Evaluating with ") + networkPath + " (" + NNUE::Network::backend() + ")");
+        else logger.Error(_network.getError());
+    }
+    _position.setNetwork(&_network);
+
+    // Known KPK, KRK and KQK results, generated on the first run and mapped from the cache after that
+    const char* bitbasePath = "resources/bitbases.bin";
+    Bitbases::init(bitbasePath);
+    const Bitbases::Info& bitbases = Bitbases::getInfo();
+    if (!bitbases.error.empty()) logger.Warn(bitbases.error);
+    logger.Info("Bitbases: " + std::to_string(bitbases.bytes / 1024) + " KB " +
+                (bitbases.fromCache ? std::string("mapped from ") + bitbasePath : std::string("generated")) +
+                " in " + std::to_string((int)bitbases.milliseconds) + " ms");
+
+    // Syzygy tables put in resources/syzygy are probed by the search, each file mapped when first needed
+    const char* syzygyPath = "resources/syzygy";
+    if (std::filesystem::is_directory(syzygyPath) && !Tablebases::isAvailable())
+    {
+        logger.Info(std::string("Syzygy: ") + syzygyPath + " ignored, this build leaves out the prober (SYZYGY=OFF)");
+    }
+    else if (std::filesystem::is_directory(syzygyPath))
+    {
+        int tables = Tablebases::init(syzygyPath);
+        logger.Info("Syzygy: " + std::to_string(tables) + " tables up to " + std::to_string(Tablebases::maxPieces()) + " pieces in " + syzygyPath);
+    }
+
     _grid->initializeChessSquares(pieceSize, "boardsquare.png");
     //FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
     FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
     //FENtoBoard("r1bk3r/p2pBpNp/n4n2/1p1NP2P/6P1/3P4/P1P1K3/q5b1");
 
+    if (gameHasAI()) {
+        setAIPlayer(AI_PLAYER);
+    }
+
     startGame();
 
-    // Pre-compute knight and king move bitboards
-    for (int i = 0; i < 64; i++)
-    {
-        _knightBitboards[i] = KnightAttacks[i];
-        _kingBitboards[i] = KingAttacks[i];
-    }
-    
-    _moves = generateMoves(stateString(), WHITE);
+    generateMoves();
 }
 
 void Chess::FENtoBoard(const std::string& fen) {
+    // Keep the bitboard position in step with the pieces on the grid
+    _position.setFEN(fen);
+
     // Current board position
     int x = 0;
     int y = 7;
@@ -150,194 +180,13 @@ void Chess::FENtoBoard(const std::string& fen) {
     }
 }
 
-void Chess::addPawnBitboardMovesToList(std::vector<BitMove>& moves, const Bitboard bitboard, const int shift)
-{
-    if (bitboard.getData() == 0) return;
-
-    bitboard.forEachBit(
-        [&](int toSquare)
-        {
-            int fromSquare = toSquare - shift;
-            moves.emplace_back(fromSquare, toSquare, Pawn);
-        }
-    );
-}
-
-//
-// Generates move objects for pawns from a bitboard, adding them to the moves list with addPawnBitboardMovesToList()
-//
-void Chess::generatePawnMoves(std::vector<BitMove>& moves, Bitboard pawnBoard, Bitboard enemyPieces, Bitboard emptySquares, char color)
-{
-    if (pawnBoard.getData() == 0) return;
-
-    // Constants for ranks and files
-    constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask (left edge)
-    constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask (right edge)
-    constexpr uint64_t Rank3(0x0000000000FF0000ULL); // Rank 3 mask (one space ahead starting rank for white)
-    constexpr uint64_t Rank6(0x0000FF0000000000ULL); // Rank 6 mask (one space ahead starting rank for black)
-
-    // Calculate single pawn moves forward
-    Bitboard singleMoves = (color == WHITE) ? 
-                           (pawnBoard.getData() << 8) & emptySquares.getData() : 
-                           (pawnBoard.getData() >> 8) & emptySquares.getData();
-    // Calculate double pawn moves from the starting rank
-    Bitboard doubleMoves = (color == WHITE) ?
-                           ((singleMoves.getData() & Rank3) << 8) & emptySquares.getData() :
-                           ((singleMoves.getData() & Rank6) >> 8) & emptySquares.getData();
-    // Calculate left and right pawn captures
-    Bitboard capturesLeft = (color == WHITE) ?
-                            ((pawnBoard.getData() & NotAFile) << 7) & enemyPieces.getData() :
-                            ((pawnBoard.getData() & NotAFile) >> 9) & enemyPieces.getData();
-    Bitboard capturesRight = (color == WHITE) ?
-                             ((pawnBoard.getData() & NotHFile) << 9) & enemyPieces.getData() :
-                             ((pawnBoard.getData() & NotHFile) >> 7) & enemyPieces.getData();
-
-    int singleShift = (color == WHITE) ? 8 : -8;
-    int doubleShift = (color == WHITE) ? 16 : -16;
-    int captureLeftShift = (color == WHITE) ? 7 : -9;
-    int captureRightShift = (color == WHITE) ? 9 : -7;
-
-    // Add all calculated moves to the move list
-    addPawnBitboardMovesToList(moves, singleMoves, singleShift);
-    addPawnBitboardMovesToList(moves, doubleMoves, doubleShift);
-    addPawnBitboardMovesToList(moves, capturesLeft, captureLeftShift);
-    addPawnBitboardMovesToList(moves, capturesRight, captureRightShift);
-}
-
-//
-// Generates move objects for knights from a bitboard
-//
-void Chess::generateKnightMoves(std::vector<BitMove>& moves, Bitboard knightBoard, uint64_t movableSquares)
-{
-    knightBoard.forEachBit(
-        [&](int fromSquare) 
-        {
-            Bitboard moveBitboard = Bitboard(_knightBitboards[fromSquare].getData() & movableSquares);
-            moveBitboard.forEachBit(
-                [&](int toSquare) 
-                { 
-                    moves.emplace_back(fromSquare, toSquare, Knight); 
-                }
-            ); 
-        }
-    );
-}
-
-void Chess::generateKingMoves(std::vector<BitMove>& moves, Bitboard kingBoard, uint64_t movableSquares)
-{
-    kingBoard.forEachBit(
-        [&](int fromSquare) 
-        {
-            Bitboard moveBitboard = Bitboard(_kingBitboards[fromSquare].getData() & movableSquares);
-            moveBitboard.forEachBit(
-                [&](int toSquare) 
-                { 
-                    moves.emplace_back(fromSquare, toSquare, King); 
-                }
-            ); 
-        }
-    );
-}
-
-void Chess::generateRookMoves(std::vector<BitMove>& moves, Bitboard rookBoard, uint64_t occupiedSquares, uint64_t friendlySquares)
-{
-    rookBoard.forEachBit(
-        [&](int fromSquare)
-        {
-            Bitboard moveBitboard = Bitboard(getRookAttacks(fromSquare, occupiedSquares) & friendlySquares);
-            moveBitboard.forEachBit(
-                [&](int toSquare) 
-                { 
-                    moves.emplace_back(fromSquare, toSquare, Rook); 
-                }
-            ); 
-        }
-    );
-}
-
-void Chess::generateBishopMoves(std::vector<BitMove>& moves, Bitboard bishopBoard, uint64_t occupiedSquares, uint64_t friendlySquares)
-{
-    bishopBoard.forEachBit(
-        [&](int fromSquare)
-        {
-            Bitboard moveBitboard = Bitboard(getBishopAttacks(fromSquare, occupiedSquares) & friendlySquares);
-            moveBitboard.forEachBit(
-                [&](int toSquare) 
-                { 
-                    moves.emplace_back(fromSquare, toSquare, Bishop); 
-                }
-            ); 
-        }
-    );
-}
-
-void Chess::generateQueenMoves(std::vector<BitMove>& moves, Bitboard queenBoard, uint64_t occupiedSquares, uint64_t friendlySquares)
-{
-    queenBoard.forEachBit(
-        [&](int fromSquare)
-        {
-            Bitboard moveBitboard = Bitboard(getQueenAttacks(fromSquare, occupiedSquares) & friendlySquares);
-            moveBitboard.forEachBit(
-                [&](int toSquare) 
-                { 
-                    moves.emplace_back(fromSquare, toSquare, Queen); 
-                }
-            ); 
-        }
-    );
-}
-
 //
-// Generates all possible moves for a given player
+// Generates all legal moves for the player to move into _moves, see MoveGenerator for the bitboard work
 //
-std::vector<BitMove> Chess::generateMoves(const std::string& gameState, char color)
+void Chess::generateMoves()
 {
-    std::vector<BitMove> moves;
-    moves.reserve(32);
-
-    for (int i = 0; i < NUM_BITBOARDS; i++) _bitboards[i] = 0ULL;
-    for (int i = 0; i < 64; i++)
-    {
-        int pieceNotation = gameState[i];
-        int bitboardIndex = _bitboardLookup[pieceNotation];
-        _bitboards[bitboardIndex] |= 1ULL << i;
-    }
-    
-    _bitboards[WHITE_ALL] = _bitboards[WHITE_PAWNS].getData() | 
-                            _bitboards[WHITE_KNIGHTS].getData() | 
-                            _bitboards[WHITE_BISHOPS].getData() | 
-                            _bitboards[WHITE_ROOKS].getData() |
-                            _bitboards[WHITE_QUEENS].getData() |
-                            _bitboards[WHITE_KING].getData();
-    _bitboards[BLACK_ALL] = _bitboards[BLACK_PAWNS].getData() |
-                            _bitboards[BLACK_KNIGHTS].getData() |
-                            _bitboards[BLACK_BISHOPS].getData() |
-                            _bitboards[BLACK_ROOKS].getData() |
-                            _bitboards[BLACK_QUEENS].getData() |
-                            _bitboards[BLACK_KING].getData();
-
-    int myBitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-    int enemyBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
-
-    uint64_t myPawns = _bitboards[WHITE_PAWNS + myBitIndex].getData();
-    uint64_t myKnights = _bitboards[WHITE_KNIGHTS + myBitIndex].getData();
-    uint64_t myBishops = _bitboards[WHITE_BISHOPS + myBitIndex].getData();
-    uint64_t myRooks = _bitboards[WHITE_ROOKS + myBitIndex].getData();
-    uint64_t myQueens = _bitboards[WHITE_QUEENS + myBitIndex].getData();
-    uint64_t myKing = _bitboards[WHITE_KING + myBitIndex].getData();
-    
-    uint64_t occupiedByEnemy = _bitboards[WHITE_ALL + enemyBitIndex].getData();
-    uint64_t occupiedByMe = _bitboards[WHITE_ALL + myBitIndex].getData();
-
-    generatePawnMoves(moves, myPawns, occupiedByEnemy, ~occupiedByMe & ~occupiedByEnemy, color);
-    generateKnightMoves(moves, myKnights, ~occupiedByMe);
-    generateBishopMoves(moves, myBishops, occupiedByMe | occupiedByEnemy, ~occupiedByMe);
-    generateRookMoves(moves, myRooks, occupiedByMe | occupiedByEnemy, ~occupiedByMe);
-    generateQueenMoves(moves, myQueens, occupiedByMe | occupiedByEnemy, ~occupiedByMe);
-    generateKingMoves(moves, myKing, ~occupiedByMe);
-
-    logger.Info("There are " + std::to_string(moves.size()) + " moves available for Player " + std::to_string(color));
-    return moves;
+    _moveGenerator.generateMoves(_position, _moves);
+    logger.Info("There are " + std::to_string(_moves.size()) + " moves available for Player " + std::to_string(_position.getSideToMove()));
 }
 
 bool Chess::actionForEmptyHolder(BitHolder &holder)
@@ -383,8 +232,178 @@ bool Chess::canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
     return false;
 }
 
+//
+// A piece was dragged and dropped on the grid: plays the first move between those squares.
+// Promotions come queen first, so a pawn dropped on the last rank becomes a queen.
+//
+void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
+{
+    ChessSquare* srcSquare = static_cast<ChessSquare*>(&src);
+    ChessSquare* dstSquare = static_cast<ChessSquare*>(&dst);
+    int srcIndex = srcSquare->getSquareIndex();
+    int dstIndex = dstSquare->getSquareIndex();
+
+    for (auto const & move : _moves)
+    {
+        if (move.from == srcIndex && move.to == dstIndex)
+        {
+            playMove(move, bit, src, dst);
+            return;
+        }
+    }
+    Game::bitMovedFromTo(bit, src, dst);
+}
+
+//
+// Plays move, whose piece the grid has already moved, into the bitboard position and finishes it
+// on the grid before ending the turn. The AI comes here directly, so under-promotions it picks
+// are played as searched.
+//
+void Chess::playMove(const BitMove& move, Bit& bit, BitHolder& src, BitHolder& dst)
+{
+    _position.makeMove(move);
+    finishSpecialMove(move, bit);
+    Game::bitMovedFromTo(bit, src, dst);
+}
+
+//
+// The grid only moves the piece that was dragged, so castling, en passant and promotion need the
+// rest of the move done by hand: the rook moved, the pawn beside taken, or the pawn swapped out
+//
+void Chess::finishSpecialMove(const BitMove& move, Bit& bit)
+{
+    if (move.isCastle())
+    {
+        bool kingside = move.to % 8 == 6;
+        ChessSquare* rookSrc = _grid->getSquareByIndex(kingside ? move.to + 1 : move.to - 2);
+        ChessSquare* rookDst = _grid->getSquareByIndex(kingside ? move.to - 1 : move.to + 1);
+        Bit* rook = rookSrc->bit();
+        if (rook)
+        {
+            rookDst->dropBitAtPoint(rook, rookDst->getPosition());
+            rookSrc->draggedBitTo(rook, rookDst);
+        }
+    }
+    else if (move.isEnPassant())
+    {
+        int capturedSquare = move.to > move.from ? move.to - 8 : move.to + 8;
+        _grid->getSquareByIndex(capturedSquare)->destroyBit();
+    }
+    else if (move.isPromotion())
+    {
+        ChessSquare* square = _grid->getSquareByIndex(move.to);
+        int playerNumber = bit.getOwner()->playerNumber();
+        Bit* promoted = PieceForPlayer(playerNumber, move.promotionPiece());
+        promoted->setPosition(square->getPosition());
+        promoted->setGameTag(move.promotionPiece());
+        // Replaces (and deletes) the pawn
+        square->setBit(promoted);
+    }
+}
+
+//
+// Starts searching the current position on the AI thread, and once it has finished plays the
+// best move on the grid. Called every frame while it is the AI's turn, so the window keeps
+// drawing while the search runs.
+//
+void Chess::updateAI()
+{
+    if (_moves.empty()) return;
+
+    if (!_aiThread.joinable())
+    {
+        int depth = std::min(getAIDepathSearches(), getAIMAXDepth());
+        _transpositionTable.newSearch();
+        _search.setThreads(getAIThreads());
+        _search.setTimeLimit(getAIMoveTime());
+        _aiDone = false;
+        _aiThread = std::thread([this, root = _position, depth]()
+        {
+            _aiMove = _search.think(root, depth,
+                [this](const SearchInfo& info)
+                {
+                    std::lock_guard<std::mutex> lock(_aiLogMutex);
+                    _aiLog.push_back(info.toString());
+                    if (info.threadNodes.size() > 1) _aiLog.push_back(info.threadNodesString());
+                }
+            );
+            _aiDone = true;
+        });
+    }
+
+    // Read before flushing, so every line logged before the search finished gets flushed
+    bool done = _aiDone;
+    flushAILog();
+    if (!done) return;
+    _aiThread.join();
+
+    BitMove bestMove = _aiMove;
+    if (bestMove.isNull()) bestMove = _moves.front();
+    logger.Info("Evaluation before move: " + evaluationString());
+
+    ChessSquare* srcSquare = _grid->getSquareByIndex(bestMove.from);
+    ChessSquare* dstSquare = _grid->getSquareByIndex(bestMove.to);
+    Bit* bit = srcSquare->bit();
+    if (!bit) return;
+
+    // Dropping onto an occupied square replaces (and deletes) the captured piece
+    dstSquare->dropBitAtPoint(bit, dstSquare->getPosition());
+    srcSquare->draggedBitTo(bit, dstSquare);
+    logger.Event("AI plays " + bestMove.toString());
+    playMove(bestMove, *bit, *srcSquare, *dstSquare);
+}
+
+//
+// Hands the search lines the AI thread has logged so far to the logger, which isn't thread safe
+//
+void Chess::flushAILog()
+{
+    std::vector<std::string> lines;
+    {
+        std::lock_guard<std::mutex> lock(_aiLogMutex);
+        lines.swap(_aiLog);
+    }
+    for (const std::string& line : lines) logger.Info(line);
+}
+
+//
+// Abandons a search still running on the AI thread and waits for the thread to finish
+//
+void Chess::stopAI()
+{
+    if (!_aiThread.joinable()) return;
+    // think clears the stop flag as it starts, so keep asking until it has returned
+    while (!_aiDone)
+    {
+        _search.stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _aiThread.join();
+    std::lock_guard<std::mutex> lock(_aiLogMutex);
+    _aiLog.clear();
+}
+
+//
+// Evaluation of the current position in centipawns from white's point of view, the same one the
+// search uses, followed by the middlegame and endgame piece-square totals, the pawn structure
+// and material imbalance scores and the phase the totals are blended by
+//
+std::string Chess::evaluationString()
+{
+    std::string s = "cp " + std::to_string(_evaluator.evaluate(_position));
+    if (_position.getNetwork()) return s + " from the network";
+
+    s += " (middlegame " + std::to_string(_position.getMiddlegameScore());
+    s += " endgame " + std::to_string(_position.getEndgameScore());
+    s += " pawns " + std::to_string(_evaluator.getPawnTable().evaluate(_position));
+    s += " imbalance " + std::to_string(_evaluator.getMaterialTable().probe(_position).imbalance);
+    s += " phase " + std::to_string(_position.getPhase()) + "/" + std::to_string(Evaluation::MAX_PHASE) + ")";
+    return s;
+}
+
 void Chess::stopGame()
 {
+    stopAI();
     _grid->forEachSquare(
         [](ChessSquare* square, int x, int y) 
         {
@@ -434,6 +453,7 @@ std::string Chess::stateString()
 
 void Chess::setStateString(const std::string &s)
 {
+    stopAI();
     _grid->forEachSquare([&](ChessSquare* square, int x, int y) {
         int index = y * 8 + x;
         char playerNumber = s[index] - '0';
@@ -466,6 +486,5 @@ void Chess::endTurn()
 	_turns.push_back(turn);
 
     // Generate moves for next player
-	char nextColor = getCurrentPlayer()->playerNumber() == 0 ? WHITE : BLACK;
-    _moves = generateMoves(stateString(), nextColor);
+    generateMoves();
 }
\ No newline at end of file
@@ -1,32 +1,16 @@
 #pragma once
 
 #include "Game.h"
-#include "Bitboard.h"
-
-#define WHITE 0
-#define BLACK 1
+#include "MoveGenerator.h"
+#include "TranspositionTable.h"
+#include "Search.h"
+#include "Evaluator.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 constexpr int pieceSize = 80;
 
-enum AllBitboards
-{
-    WHITE_PAWNS,
-    WHITE_KNIGHTS,
-    WHITE_BISHOPS,
-    WHITE_ROOKS,
-    WHITE_QUEENS,
-    WHITE_KING,
-    WHITE_ALL,
-    BLACK_PAWNS,
-    BLACK_KNIGHTS,
-    BLACK_BISHOPS,
-    BLACK_ROOKS,
-    BLACK_QUEENS,
-    BLACK_KING,
-    BLACK_ALL,
-    EMPTY_SQUARES
-};
-
 class Chess : public Game
 {
 public:
@@ -38,6 +22,7 @@ public:
     bool canBitMoveFrom(Bit &bit, BitHolder &src) override;
     bool canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
     bool actionForEmptyHolder(BitHolder &holder) override;
+    void bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
     void clearBoardHighlights() override;
     void endTurn() override;
 
@@ -52,29 +37,42 @@ public:
 
     Grid* getGrid() override { return _grid; }
 
-private:
-    const int NUM_BITBOARDS = 14;
+    // AI
+    void updateAI() override;
+    bool gameHasAI() override { return true; }
+    std::string evaluationString() override;
 
+private:
     Bit* PieceForPlayer(const int playerNumber, ChessPiece piece);
     Player* ownerAt(int x, int y) const;
     void FENtoBoard(const std::string& fen);
+    void playMove(const BitMove& move, Bit& bit, BitHolder& src, BitHolder& dst);
+    void finishSpecialMove(const BitMove& move, Bit& bit);
+    void stopAI();
+    void flushAILog();
     char pieceNotation(int x, int y) const;
 
-    // Generating bitboards and moves
-    void addPawnBitboardMovesToList(std::vector<BitMove>& moves, const Bitboard bitboard, const int shift);
-    void generatePawnMoves(std::vector<BitMove>& moves, Bitboard pawnBoard, Bitboard enemyPieces, Bitboard emptySquares, char color);
-    void generateKnightMoves(std::vector<BitMove>& moves, Bitboard knightBoard, uint64_t movableSquares);
-    void generateKingMoves(std::vector<BitMove>& moves, Bitboard kingBoard, uint64_t movableSquares);
-    void generateRookMoves(std::vector<BitMove>& moves, Bitboard rookBoard, uint64_t occupiedSquares, uint64_t friendlySquares);
-    void generateBishopMoves(std::vector<BitMove>& moves, Bitboard bishopBoard, uint64_t occupiedSquares, uint64_t friendlySquares);
-    void generateQueenMoves(std::vector<BitMove>& moves, Bitboard queenBoard, uint64_t occupiedSquares, uint64_t friendlySquares);
-    std::vector<BitMove> generateMoves(const std::string& gameState, char color);
+    // Generating moves
+    void generateMoves();
 
     Grid* _grid;
-    int _bitboardLookup[128];
-    Bitboard _bitboards[14];
-    Bitboard _knightBitboards[64];
-    Bitboard _kingBitboards[64];
-
-    std::vector<BitMove> _moves;
+    Position _position;
+    // Evaluation network, used when resources/network.nnue exists
+    NNUE::Network _network;
+    // Evaluation for evaluationString(); the search threads have their own
+    Evaluator _evaluator;
+    MoveGenerator _moveGenerator;
+    TranspositionTable _transpositionTable;
+    Search _search;
+
+    // The AI searches on a thread of its own so the window keeps drawing; updateAI starts it and
+    // then checks each frame whether the move is ready
+    std::thread _aiThread;
+    std::atomic<bool> _aiDone;
+    BitMove _aiMove;
+    // Search log lines, written by the AI thread and handed to the logger on the UI thread
+    std::mutex _aiLogMutex;
+    std::vector<std::string> _aiLog;
+
+    MoveList _moves;
 };
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <stdint.h>
+
+// Instruction set extensions are only looked for on 64-bit x86, and code built for them is only
+// run once these checks have found them, so the program itself needs no -mavx2 or -mbmi2
+#if defined(__x86_64__) || defined(_M_X64)
+    #define CPU_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+// Marks a function to be compiled for AVX2 on its own (MSVC compiles intrinsics without it)
+#if defined(_MSC_VER)
+    #define CPU_TARGET_AVX2
+#else
+    #define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// True if the CPU has BMI2 and its PEXT is fast. AMD before Zen 3 (family 19h) implements PEXT
+// in microcode taking hundreds of cycles, so those CPUs stay on magic multiplication.
+static inline bool cpuHasFastPext(void) {
+#if defined(CPU_X86)
+    unsigned int regs[4];
+#if defined(_MSC_VER)
+    auto cpuid = [&](unsigned int leaf) { __cpuidex((int*)regs, (int)leaf, 0); };
+#else
+    auto cpuid = [&](unsigned int leaf) { __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]); };
+#endif
+    cpuid(0);
+    unsigned int maxLeaf = regs[0];
+    bool amd = regs[1] == 0x68747541; // "Auth" of "AuthenticAMD"
+    if (maxLeaf < 7) return false;
+
+    cpuid(7);
+    bool bmi2 = (regs[1] >> 8) & 1;
+    if (!bmi2) return false;
+
+    cpuid(1);
+    unsigned int family = (regs[0] >> 8) & 0xf;
+    if (family == 0xf) family += (regs[0] >> 20) & 0xff;
+    return !(amd && family < 0x19);
+#else
+    return false;
+#endif
+}
+
+// True if the CPU has AVX2 and the OS saves the YMM registers
+static inline bool cpuHasAvx2(void) {
+#if defined(CPU_X86)
+    unsigned int regs[4];
+#if defined(_MSC_VER)
+    auto cpuid = [&](unsigned int leaf) { __cpuidex((int*)regs, (int)leaf, 0); };
+#else
+    auto cpuid = [&](unsigned int leaf) { __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]); };
+#endif
+    cpuid(0);
+    if (regs[0] < 7) return false;
+
+    cpuid(1);
+    bool osxsave = (regs[2] >> 27) & 1;
+    bool avx = (regs[2] >> 28) & 1;
+    if (!osxsave || !avx) return false;
+#if defined(_MSC_VER)
+    uint64_t xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    uint64_t xcr0 = ((uint64_t)xcr0High << 32) | xcr0Low;
+#endif
+    if ((xcr0 & 6) != 6) return false;
+
+    cpuid(7);
+    return (regs[1] >> 5) & 1;
+#else
+    return false;
+#endif
+}
+
+#endif // CPU_FEATURES_H
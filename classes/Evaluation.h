@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Position.h"
+
+//
+// Material and piece-square tables, with a middlegame and an endgame value for every piece on
+// every square. Position keeps the sums of both up to date as pieces move, along with the game
+// phase, and the evaluation blends the two by phase (a tapered evaluation), so evaluating a leaf
+// costs a couple of multiplies instead of a pass over the bitboards.
+//
+namespace Evaluation
+{
+    // Piece values indexed by piece type, pawn to king
+    constexpr int MiddlegameValues[6] = { 82, 337, 365, 477, 1025, 0 };
+    constexpr int EndgameValues[6] = { 94, 281, 297, 512, 936, 0 };
+
+    // How much each piece counts towards the game phase. With every piece on the board the phase
+    // is MAX_PHASE, pure middlegame; with only kings and pawns it is 0, pure endgame.
+    constexpr int PhaseWeights[6] = { 0, 1, 1, 2, 4, 0 };
+    constexpr int MAX_PHASE = 24;
+
+    // Square bonuses from white's side of the board, rank 8 first as the board is drawn. The same
+    // tables are used for black by flipping the rank.
+    constexpr int PawnTable[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0
+    };
+    // In the endgame a pawn is worth more the closer it is to queening, wherever its file
+    constexpr int PawnEndgameTable[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+         90,  90,  90,  90,  90,  90,  90,  90,
+         55,  55,  55,  55,  55,  55,  55,  55,
+         30,  30,  30,  30,  30,  30,  30,  30,
+         15,  15,  15,  15,  15,  15,  15,  15,
+          5,   5,   5,   5,   5,   5,   5,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0
+    };
+    constexpr int KnightTable[64] = {
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50
+    };
+    constexpr int BishopTable[64] = {
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20
+    };
+    constexpr int RookTable[64] = {
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0
+    };
+    constexpr int QueenTable[64] = {
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20
+    };
+    // The king hides behind its pawns in the middlegame and heads for the centre in the endgame
+    constexpr int KingTable[64] = {
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20
+    };
+    constexpr int KingEndgameTable[64] = {
+        -50, -40, -30, -20, -20, -30, -40, -50,
+        -30, -20, -10,   0,   0, -10, -20, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -30,   0,   0,   0,   0, -30, -30,
+        -50, -30, -30, -30, -30, -30, -30, -50
+    };
+
+    constexpr const int* MiddlegameTables[6] = { PawnTable, KnightTable, BishopTable, RookTable, QueenTable, KingTable };
+    constexpr const int* EndgameTables[6] = { PawnEndgameTable, KnightTable, BishopTable, RookTable, QueenTable, KingEndgameTable };
+
+    // Value plus square bonus for every bitboard index (WHITE_PAWNS .. BLACK_KING) and square,
+    // positive for white pieces and negative for black ones, so Position can just add them up
+    struct PieceSquareTable
+    {
+        int middlegame[EMPTY_SQUARES][64];
+        int endgame[EMPTY_SQUARES][64];
+        int phase[EMPTY_SQUARES];
+
+        constexpr PieceSquareTable() : middlegame(), endgame(), phase()
+        {
+            for (int piece = 0; piece < 6; piece++)
+            {
+                phase[WHITE_PAWNS + piece] = PhaseWeights[piece];
+                phase[BLACK_PAWNS + piece] = PhaseWeights[piece];
+                for (int square = 0; square < 64; square++)
+                {
+                    // Square 0 is a1, which is the first square of the last row of the tables
+                    int whiteRow = square ^ 56;
+                    int blackRow = square;
+                    middlegame[WHITE_PAWNS + piece][square] = MiddlegameValues[piece] + MiddlegameTables[piece][whiteRow];
+                    endgame[WHITE_PAWNS + piece][square] = EndgameValues[piece] + EndgameTables[piece][whiteRow];
+                    middlegame[BLACK_PAWNS + piece][square] = -(MiddlegameValues[piece] + MiddlegameTables[piece][blackRow]);
+                    endgame[BLACK_PAWNS + piece][square] = -(EndgameValues[piece] + EndgameTables[piece][blackRow]);
+                }
+            }
+        }
+    };
+
+    inline constexpr PieceSquareTable PieceSquare;
+
+    // Blends the middlegame and endgame scores by phase. Promotions can push the phase past
+    // MAX_PHASE, which still counts as a pure middlegame.
+    constexpr int taper(int middlegame, int endgame, int phase)
+    {
+        if (phase > MAX_PHASE) phase = MAX_PHASE;
+        return (middlegame * phase + endgame * (MAX_PHASE - phase)) / MAX_PHASE;
+    }
+}
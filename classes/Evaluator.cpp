@@ -0,0 +1,34 @@
+#include "Evaluator.h"
+#include <algorithm>
+
+// True if each side's only bishop stands on a different square color
+static bool oppositeBishops(const Position& position)
+{
+    constexpr uint64_t DarkSquares = 0xAA55AA55AA55AA55ULL;
+    bool whiteDark = (position.getBitboard(WHITE_BISHOPS) & DarkSquares) != 0;
+    bool blackDark = (position.getBitboard(BLACK_BISHOPS) & DarkSquares) != 0;
+    return whiteDark != blackDark;
+}
+
+bool Evaluator::isDrawn(const Position& position)
+{
+    const MaterialTable::Entry& material = _materialTable.probe(position);
+    return material.drawn || (material.bitbase >= 0 && !MaterialTable::bitbaseWins(position, material));
+}
+
+int Evaluator::evaluate(const Position& position)
+{
+    const MaterialTable::Entry& material = _materialTable.probe(position);
+    if (material.bitbase >= 0 && !MaterialTable::bitbaseWins(position, material)) return 0;
+    if (material.evaluator) return material.evaluator(position, material.strongSide);
+    if (material.drawn) return 0;
+
+    int score = position.evaluate();
+    // A network sees pawn structure and material balance by itself
+    if (!position.getNetwork()) score += _pawnTable.evaluate(position) + material.imbalance;
+
+    // Opposite colored bishops are drawish even a pawn or two up
+    int scale = material.scale[score > 0 ? WHITE : BLACK];
+    if (material.bishopsOnly && oppositeBishops(position)) scale = std::min(scale, SCALE_NORMAL / 2);
+    return score * scale / SCALE_NORMAL;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Position.h"
+#include "PawnHashTable.h"
+#include "MaterialTable.h"
+
+//
+// The static evaluation the search uses: Position's material and piece-square totals (or its
+// network), pawn structure from the pawn hash, and the imbalance, scale factors and known endings
+// from the material table. Both tables are caches only this evaluator writes, so each search
+// thread has one of its own.
+//
+class Evaluator
+{
+public:
+    // Centipawns from white's point of view
+    int evaluate(const Position& position);
+    // True if neither side has anything left to mate with, or a bitbase says the ending is drawn
+    bool isDrawn(const Position& position);
+
+    PawnHashTable& getPawnTable() { return _pawnTable; }
+    MaterialTable& getMaterialTable() { return _materialTable; }
+
+private:
+    PawnHashTable _pawnTable;
+    MaterialTable _materialTable;
+};
@@ -15,6 +15,8 @@ Game::Game()
 	_gameOptions.rowY = 0;
 	_gameOptions.score = 0;
 	_gameOptions.AIDepthSearches = 0;
+	_gameOptions.AIThreads = 1;
+	_gameOptions.AIMoveTime = 0;
 	_gameOptions.AIvsAI = false;
 
 	_table = nullptr;
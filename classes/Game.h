@@ -41,6 +41,9 @@ struct GameOptions
 	int score;
 	int AIDepthSearches;
 	int AIMAXDepth;
+	int AIThreads;
+	// Milliseconds the AI may think per move, 0 for no limit
+	int AIMoveTime;
 	bool AIvsAI;
 };
 
@@ -96,6 +99,8 @@ public:
 	virtual bool gameHasAI();
 	virtual void updateAI();
 	virtual void pieceTaken(Bit *bit){};
+	// Static evaluation of the current board for the debug panel, empty if the game has none
+	virtual std::string evaluationString() { return ""; };
 
 	virtual std::string initialStateString() = 0;
 	virtual std::string stateString() = 0;
@@ -105,6 +110,8 @@ public:
 	void setAIPlayer(unsigned int playerNumber);
 	virtual int getAIDepathSearches() { return _gameOptions.AIDepthSearches; };
 	virtual int getAIMAXDepth() { return _gameOptions.AIMAXDepth; };
+	virtual int getAIThreads() { return _gameOptions.AIThreads; };
+	virtual int getAIMoveTime() { return _gameOptions.AIMoveTime; };
 
 	// mouse functions
 	void scanForMouse();
@@ -2,9 +2,15 @@
 #define MAGIC_BITBOARDS_H
 
 #include <stdint.h>
+#include <array>
+#include <mutex>
+
+// BMI2 PEXT and AVX2 are only looked for on 64-bit x86; everywhere else the magic multiply and
+// plain 64-bit set-wise fills are used
+#include "CpuFeatures.h"
 
 // Generate rook attacks for a given square and blocking pieces
-static inline uint64_t ratt(int sq, uint64_t block) {
+static constexpr uint64_t ratt(int sq, uint64_t block) {
     uint64_t result = 0ULL;
     int rk = sq / 8, fl = sq % 8, r, f;
 
@@ -32,7 +38,7 @@ static inline uint64_t ratt(int sq, uint64_t block) {
 }
 
 // Generate bishop attacks for a given square and blocking pieces
-static inline uint64_t batt(int sq, uint64_t block) {
+static constexpr uint64_t batt(int sq, uint64_t block) {
     uint64_t result = 0ULL;
     int rk = sq / 8, fl = sq % 8, r, f;
 
@@ -60,9 +66,9 @@ static inline uint64_t batt(int sq, uint64_t block) {
 }
 
 // Compiler-specific bit manipulation functions
-#ifdef __clang__
-    // Clang/LLVM specific bit counting
-    static inline int countOnes(uint64_t b) {
+#if defined(__clang__) || defined(__GNUC__)
+    // Clang/LLVM and GCC specific bit counting
+    static constexpr int countOnes(uint64_t b) {
         return __builtin_popcountll(b);
     }
 
@@ -72,7 +78,7 @@ static inline uint64_t batt(int sq, uint64_t block) {
     }
 #else
     // Fallback bit counting implementation
-    static inline int countOnes(uint64_t b) {
+    static constexpr int countOnes(uint64_t b) {
         int r = 0;
         while (b) {
             r++;
@@ -84,13 +90,13 @@ static inline uint64_t batt(int sq, uint64_t block) {
     // Fallback first bit implementation
     static inline int getFirstBit(uint64_t b) {
         const int BitTable[64] = {
-            63, 30, 3, 32, 25, 41, 22, 33, 15, 50, 42, 13, 11, 53, 19, 34,
-            61, 29, 2, 51, 21, 43, 45, 10, 18, 47, 1, 54, 9, 57, 0, 35,
-            62, 31, 40, 4, 49, 5, 52, 26, 60, 6, 23, 44, 46, 27, 56, 16,
-            7, 39, 48, 24, 59, 14, 12, 55, 38, 28, 58, 20, 37, 17, 36, 8
+            0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+            62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+            63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+            46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
         };
         uint64_t debruijn = 0x03f79d71b4cb0a89ULL;
-        return BitTable[((b ^ (b-1)) * debruijn) >> 58];
+        return BitTable[((b & (0 - b)) * debruijn) >> 58];
     }
 #endif
 
@@ -262,10 +268,6 @@ const int BAttackSize[64] = {
   64,
 };
 
-// Attack lookup tables
-static uint64_t* RAttacks[64];
-static uint64_t* BAttacks[64];
-
 // Magic bitboard shift amounts
 const int RShifts[64] = {
   52,
@@ -808,66 +810,269 @@ const uint64_t KingAttacks[64] = {
   0x40c0000000000000ULL,
 };
 
+// Total number of attack sets over all squares, for packing them into one table
+constexpr int attackTableSize(const int* sizes) {
+    int total = 0;
+    for (int square = 0; square < 64; square++) total += sizes[square];
+    return total;
+}
+
+// The same for PEXT indexing, where each square needs exactly 2^(bits in its mask) entries
+constexpr int pextTableSize(const uint64_t* masks) {
+    int total = 0;
+    for (int square = 0; square < 64; square++) total += 1 << countOnes(masks[square]);
+    return total;
+}
+
+constexpr int RAttackTableSize = attackTableSize(RAttackSize);
+constexpr int BAttackTableSize = attackTableSize(BAttackSize);
+constexpr int RPextTableSize = pextTableSize(RMasks);
+constexpr int BPextTableSize = pextTableSize(BMasks);
+
+// attackgen includes this header to write the attack tables, so it stops here
+#ifndef MAGIC_BITBOARDS_GENERATOR
+
+// Squares strictly between any two squares sharing a rank, file or diagonal (empty otherwise),
+// worked out at compile time
+constexpr std::array<std::array<uint64_t, 64>, 64> makeBetweenBitboards() {
+    std::array<std::array<uint64_t, 64>, 64> between{};
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            if (ratt(a, 0ULL) & (1ULL << b)) between[a][b] = ratt(a, 1ULL << b) & ratt(b, 1ULL << a);
+            else if (batt(a, 0ULL) & (1ULL << b)) between[a][b] = batt(a, 1ULL << b) & batt(b, 1ULL << a);
+        }
+    }
+    return between;
+}
+
+static constexpr std::array<std::array<uint64_t, 64>, 64> BetweenBitboards = makeBetweenBitboards();
+
+// Parallel bit extract and deposit: pext packs the bits of b selected by mask into the low bits
+// of the result, and pdep spreads the low bits of b back out over the bits of mask. Only ever
+// called once initMagicBitboards has found BMI2, so they are emitted as plain instructions
+// without compiling the whole program for BMI2.
+#if defined(CPU_X86)
+static inline uint64_t pext(uint64_t b, uint64_t mask) {
+#if defined(_MSC_VER)
+    return _pext_u64(b, mask);
+#else
+    uint64_t result;
+    __asm__("pextq %2, %1, %0" : "=r"(result) : "r"(b), "r"(mask));
+    return result;
+#endif
+}
+
+static inline uint64_t pdep(uint64_t b, uint64_t mask) {
+#if defined(_MSC_VER)
+    return _pdep_u64(b, mask);
+#else
+    uint64_t result;
+    __asm__("pdepq %2, %1, %0" : "=r"(result) : "r"(b), "r"(mask));
+    return result;
+#endif
+}
+#endif
+
+// Every rook attack set followed by every bishop attack set, twice. MagicAttackTable is laid out
+// for magic multiplication (fancy magics, so each square's slice is sized by its shift), 841 KB.
+// RookPextAttackTable and BishopPextAttackTable are laid out for PEXT, which needs just as many
+// entries; but a rook entry only keeps which of the rook's empty-board ray squares it attacks, 16
+// bits that PDEP spreads back out, so the PEXT tables come to 241 KB. Bishop entries are left
+// whole, as their table is small and the extra PDEP costs more than it saves. All are written
+// out as const data by attackgen at build time, so nothing is computed at startup and the pages
+// are read-only and shared. x86 builds carry both layouts, since which one is used is only known
+// from CPUID at startup, and only the pages the chosen one touches are ever read in; other builds
+// only have the magic table.
+#include "SliderAttackTables.inc"
+
+// Everything a lookup for one square needs, aligned to its 32 bytes so the entries pack two to a
+// cache line and a lookup never straddles two
+struct alignas(32) Magic {
+    uint64_t mask;
+    uint64_t magic;
+    const uint64_t* attacks;
+    int shift;
+};
+static_assert(sizeof(Magic) == 32, "Magic entries must pack two to a cache line");
+
+// Points each square's Magic at its slice of table, at compile time
+constexpr std::array<Magic, 64> makeMagics(const uint64_t* table, const int* sizes, const uint64_t* masks,
+                                           const uint64_t* magicNumbers, const int* shifts) {
+    std::array<Magic, 64> magics{};
+    for (int square = 0; square < 64; square++) {
+        magics[square] = { masks[square], magicNumbers[square], table, shifts[square] };
+        table += sizes[square];
+    }
+    return magics;
+}
+
+static constexpr std::array<Magic, 64> RookMagics = makeMagics(MagicAttackTable, RAttackSize, RMasks, RMagic, RShifts);
+static constexpr std::array<Magic, 64> BishopMagics = makeMagics(MagicAttackTable + RAttackTableSize, BAttackSize, BMasks, BMagic, BShifts);
+
+#if defined(CPU_X86)
+// The same for PEXT lookups: the occupancy mask, the rays a rook's stored bits are spread back
+// over, and the square's slice of its PEXT table
+template <typename Entry>
+struct alignas(32) PextEntry {
+    uint64_t mask;
+    uint64_t rays;
+    const Entry* attacks;
+};
+
+template <typename Entry>
+constexpr std::array<PextEntry<Entry>, 64> makePextEntries(const Entry* table, const uint64_t* masks, uint64_t (*slowAttacks)(int, uint64_t)) {
+    std::array<PextEntry<Entry>, 64> entries{};
+    for (int square = 0; square < 64; square++) {
+        entries[square] = { masks[square], slowAttacks(square, 0), table };
+        table += 1 << countOnes(masks[square]);
+    }
+    return entries;
+}
+
+static constexpr std::array<PextEntry<uint16_t>, 64> RookPextEntries = makePextEntries(RookPextAttackTable, RMasks, ratt);
+static constexpr std::array<PextEntry<uint64_t>, 64> BishopPextEntries = makePextEntries(BishopPextAttackTable, BMasks, batt);
+#endif
+
+// Set once by initMagicBitboards when lookups index with PEXT instead of the magic multiply,
+// and when set-wise attacks use AVX2. Only read after that, so any number of generators and
+// threads can share them.
+static bool UsePext = false;
+static bool UseAvx2 = false;
+
 // Helper functions for move generation
 static inline uint64_t getRookAttacks(int square, uint64_t occupied) {
-    occupied &= RMasks[square];
-    occupied *= RMagic[square];
-    occupied >>= RShifts[square];
-    return RAttacks[square][occupied];
+#if defined(CPU_X86)
+    if (UsePext) {
+        const PextEntry<uint16_t>& p = RookPextEntries[square];
+        return pdep(p.attacks[pext(occupied, p.mask)], p.rays);
+    }
+#endif
+    const Magic& m = RookMagics[square];
+    return m.attacks[((occupied & m.mask) * m.magic) >> m.shift];
 }
 
 static inline uint64_t getBishopAttacks(int square, uint64_t occupied) {
-    occupied &= BMasks[square];
-    occupied *= BMagic[square];
-    occupied >>= BShifts[square];
-    return BAttacks[square][occupied];
+#if defined(CPU_X86)
+    if (UsePext) {
+        const PextEntry<uint64_t>& p = BishopPextEntries[square];
+        return p.attacks[pext(occupied, p.mask)];
+    }
+#endif
+    const Magic& m = BishopMagics[square];
+    return m.attacks[((occupied & m.mask) * m.magic) >> m.shift];
 }
 
 static inline uint64_t getQueenAttacks(int square, uint64_t occupied) {
     return getRookAttacks(square, occupied) | getBishopAttacks(square, occupied);
 }
 
-// Initialize magic bitboards
-void initMagicBitboards(void) {
-    int square, i;
-    uint64_t subset, index;
-
-    // Initialize rook attack tables
-    for (square = 0; square < 64; square++) {
-        RAttacks[square] = new uint64_t[RAttackSize[square]];
-        uint64_t mask = RMasks[square];
-        int bits = countOnes(mask);
-        int n = 1 << bits;
-
-        for (i = 0; i < n; i++) {
-            subset = indexToUint64(i, bits, mask);
-            index = (subset * RMagic[square]) >> RShifts[square];
-            RAttacks[square][index] = ratt(square, subset);
-        }
-    }
+// Set-wise slider attacks (Kogge-Stone): every square attacked by a whole set of sliders, found
+// by flooding each direction through the empty squares in three doubling steps instead of
+// looking the pieces up one at a time. Cheaper than lookups when a side's full attack map is wanted.
 
-    // Initialize bishop attack tables
-    for (square = 0; square < 64; square++) {
-        BAttacks[square] = new uint64_t[BAttackSize[square]];
-        uint64_t mask = BMasks[square];
-        int bits = countOnes(mask);
-        int n = 1 << bits;
-
-        for (i = 0; i < n; i++) {
-            subset = indexToUint64(i, bits, mask);
-            index = (subset * BMagic[square]) >> BShifts[square];
-            BAttacks[square][index] = batt(square, subset);
-        }
-    }
+constexpr uint64_t NotAFile = 0xFEFEFEFEFEFEFEFEULL;
+constexpr uint64_t NotHFile = 0x7F7F7F7F7F7F7F7FULL;
+
+// Floods gen along one direction through the squares in empty. Shift is the square step of the
+// direction (positive towards rank 8) and Mask the squares a step can land on without wrapping.
+template <int Shift, uint64_t Mask>
+static inline uint64_t occludedFill(uint64_t gen, uint64_t empty) {
+    auto shift = [](uint64_t b, int steps) { return Shift > 0 ? b << (Shift * steps) : b >> (-Shift * steps); };
+    uint64_t pro = empty & Mask;
+    gen |= pro & shift(gen, 1);
+    pro &= shift(pro, 1);
+    gen |= pro & shift(gen, 2);
+    pro &= shift(pro, 2);
+    gen |= pro & shift(gen, 4);
+    return gen;
 }
 
-// Cleanup magic bitboard tables
-void cleanupMagicBitboards(void) {
-    int square;
-    for (square = 0; square < 64; square++) {
-        delete[] RAttacks[square];
-        delete[] BAttacks[square];
-    }
+// One direction after another in 64-bit registers; the last step off each fill is the
+// directional shift macro for it
+static inline uint64_t sliderAttacksScalar(uint64_t rooksQueens, uint64_t bishopsQueens, uint64_t occupied) {
+    uint64_t empty = ~occupied;
+    uint64_t north = occludedFill<8, ~0ULL>(rooksQueens, empty);
+    uint64_t south = occludedFill<-8, ~0ULL>(rooksQueens, empty);
+    uint64_t east = occludedFill<1, NotAFile>(rooksQueens, empty);
+    uint64_t west = occludedFill<-1, NotHFile>(rooksQueens, empty);
+    uint64_t northEast = occludedFill<9, NotAFile>(bishopsQueens, empty);
+    uint64_t northWest = occludedFill<7, NotHFile>(bishopsQueens, empty);
+    uint64_t southEast = occludedFill<-7, NotAFile>(bishopsQueens, empty);
+    uint64_t southWest = occludedFill<-9, NotHFile>(bishopsQueens, empty);
+    return NORTH(north) | SOUTH(south) | EAST(east) | WEST(west) |
+           NORTH_EAST(northEast) | NORTH_WEST(northWest) | SOUTH_EAST(southEast) | SOUTH_WEST(southWest);
+}
+
+#if defined(CPU_X86)
+// The same fills four directions at a time, one per 64-bit lane: north, east, north-east and
+// north-west with variable left shifts, then south, west, south-west and south-east with right
+// shifts. The first two lanes flood the rooks and queens, the other two the bishops and queens.
+// Only this function is built for AVX2, and it is only called once initMagicBitboards has found it.
+CPU_TARGET_AVX2 static uint64_t sliderAttacksAvx2(uint64_t rooksQueens, uint64_t bishopsQueens, uint64_t occupied) {
+    const __m256i steps = _mm256_setr_epi64x(8, 1, 9, 7);
+    const __m256i steps2 = _mm256_add_epi64(steps, steps);
+    const __m256i steps4 = _mm256_add_epi64(steps2, steps2);
+    const __m256i upMask = _mm256_setr_epi64x(-1, (long long)NotAFile, (long long)NotAFile, (long long)NotHFile);
+    const __m256i downMask = _mm256_setr_epi64x(-1, (long long)NotHFile, (long long)NotHFile, (long long)NotAFile);
+    const __m256i gen = _mm256_setr_epi64x((long long)rooksQueens, (long long)rooksQueens, (long long)bishopsQueens, (long long)bishopsQueens);
+    const __m256i empty = _mm256_set1_epi64x((long long)~occupied);
+
+    __m256i g = gen;
+    __m256i pro = _mm256_and_si256(empty, upMask);
+    g = _mm256_or_si256(g, _mm256_and_si256(pro, _mm256_sllv_epi64(g, steps)));
+    pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, steps));
+    g = _mm256_or_si256(g, _mm256_and_si256(pro, _mm256_sllv_epi64(g, steps2)));
+    pro = _mm256_and_si256(pro, _mm256_sllv_epi64(pro, steps2));
+    g = _mm256_or_si256(g, _mm256_and_si256(pro, _mm256_sllv_epi64(g, steps4)));
+    __m256i attacks = _mm256_and_si256(_mm256_sllv_epi64(g, steps), upMask);
+
+    g = gen;
+    pro = _mm256_and_si256(empty, downMask);
+    g = _mm256_or_si256(g, _mm256_and_si256(pro, _mm256_srlv_epi64(g, steps)));
+    pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, steps));
+    g = _mm256_or_si256(g, _mm256_and_si256(pro, _mm256_srlv_epi64(g, steps2)));
+    pro = _mm256_and_si256(pro, _mm256_srlv_epi64(pro, steps2));
+    g = _mm256_or_si256(g, _mm256_and_si256(pro, _mm256_srlv_epi64(g, steps4)));
+    attacks = _mm256_or_si256(attacks, _mm256_and_si256(_mm256_srlv_epi64(g, steps), downMask));
+
+    // OR the four lanes together
+    __m128i folded = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+    folded = _mm_or_si128(folded, _mm_unpackhi_epi64(folded, folded));
+    return (uint64_t)_mm_cvtsi128_si64(folded);
 }
+#endif
+
+// Every square attacked by the given rooks and queens along ranks and files, and by the given
+// bishops and queens along diagonals
+static inline uint64_t getSliderAttacksSetwise(uint64_t rooksQueens, uint64_t bishopsQueens, uint64_t occupied) {
+#if defined(CPU_X86)
+    if (UseAvx2) return sliderAttacksAvx2(rooksQueens, bishopsQueens, occupied);
+#endif
+    return sliderAttacksScalar(rooksQueens, bishopsQueens, occupied);
+}
+
+// Switches lookups to magic or PEXT indexing and set-wise attacks to scalar or AVX2. Not thread
+// safe, only for magicbench to compare them; everything else goes through initMagicBitboards.
+static void selectSliderAttacks(bool usePext, bool useAvx2) {
+    UsePext = usePext;
+    UseAvx2 = useAvx2;
+}
+
+static std::once_flag MagicBitboardsInitialized;
+
+// Picks PEXT indexing if the CPU is good at it, magic multiplication otherwise, and AVX2 set-wise
+// attacks if it has them. The tables are already built, so this is just a CPUID check, made by
+// whichever caller gets here first; later calls, from any thread, wait for it and then do nothing.
+void initMagicBitboards(void) {
+    std::call_once(MagicBitboardsInitialized, [] { selectSliderAttacks(cpuHasFastPext(), cpuHasAvx2()); });
+}
+
+// Which way slider attacks are being worked out, for the log
+const char* sliderAttackBackend(void) {
+    if (UsePext) return UseAvx2 ? "BMI2 PEXT lookups, AVX2 set-wise fills" : "BMI2 PEXT lookups, scalar set-wise fills";
+    return UseAvx2 ? "magic multiplication lookups, AVX2 set-wise fills" : "magic multiplication lookups, scalar set-wise fills";
+}
+
+#endif // MAGIC_BITBOARDS_GENERATOR
 
-#endif // MAGIC_BITBOARDS_H
\ No newline at end of file
+#endif // MAGIC_BITBOARDS_H
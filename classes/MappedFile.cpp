@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : _data(nullptr), _size(0)
+#ifdef _WIN32
+      , _file(nullptr), _mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void MappedFile::unmap()
+{
+#ifdef _WIN32
+    if (_data) UnmapViewOfFile(_data);
+    if (_mapping) CloseHandle((HANDLE)_mapping);
+    if (_file) CloseHandle((HANDLE)_file);
+    _file = _mapping = nullptr;
+#else
+    if (_data) munmap((void*)_data, _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+bool MappedFile::map(const std::string& path)
+{
+    unmap();
+    _error.clear();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        _error = "can't open " + path;
+        return false;
+    }
+    _file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        _error = "can't map " + path + " (empty or unreadable)";
+        unmap();
+        return false;
+    }
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    _data = _mapping ? (const uint8_t*)MapViewOfFile((HANDLE)_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!_data)
+    {
+        _error = "can't map " + path;
+        unmap();
+        return false;
+    }
+    _size = (size_t)size.QuadPart;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        _error = "can't open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        _error = "can't map " + path + " (empty or unreadable)";
+        return false;
+    }
+    void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+    // The mapping keeps the file open by itself
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        _error = "can't map " + path;
+        return false;
+    }
+    _data = (const uint8_t*)data;
+    _size = (size_t)info.st_size;
+#endif
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//
+// A whole file mapped read-only into memory. Pages are only read from disk when they are first
+// touched, and the operating system shares them between processes mapping the same file.
+//
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the file, replacing anything already mapped. Returns false, with the reason in
+    // getError(), if the file can't be opened or mapped.
+    bool map(const std::string& path);
+    void unmap();
+    bool isMapped() const { return _data != nullptr; }
+
+    const uint8_t* getData() const { return _data; }
+    size_t getSize() const { return _size; }
+    const std::string& getError() const { return _error; }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+#ifdef _WIN32
+    void* _file;
+    void* _mapping;
+#endif
+    std::string _error;
+};
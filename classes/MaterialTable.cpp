@@ -0,0 +1,198 @@
+#include "MaterialTable.h"
+#include "Evaluation.h"
+#include <algorithm>
+#include <cstdlib>
+
+// Pawn count each piece's value is measured against for the imbalance
+constexpr int ImbalancePawns = 5;
+constexpr int BishopPair = 40;
+constexpr int KnightPerPawn = 6;
+constexpr int RookPerPawn = -12;
+
+static inline int kingSquare(const Position& position, int color)
+{
+    int square = 0;
+    Bitboard(position.getBitboard(color == WHITE ? WHITE_KING : BLACK_KING)).forEachBit([&](int s) { square = s; });
+    return square;
+}
+
+static inline int distance(int a, int b)
+{
+    return std::max(std::abs((a & 7) - (b & 7)), std::abs((a >> 3) - (b >> 3)));
+}
+
+// Rank and file distance from the centre, 0 on the four centre squares and 6 in the corners
+static inline int centreDistance(int square)
+{
+    int file = square & 7;
+    int rank = square >> 3;
+    return std::max(3 - file, file - 4) + std::max(3 - rank, rank - 4);
+}
+
+// Endgame material of one side, pawns left out
+static int pieceMaterial(const Position& position, int color)
+{
+    int base = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    int material = 0;
+    for (int piece = Knight - Pawn; piece <= Queen - Pawn; piece++) material += position.pieceCount(base + piece) * Evaluation::EndgameValues[piece];
+    return material;
+}
+
+//
+// King and enough material to mate against a lone king (KRK, KQK, KBBK, ...): drive the
+// defending king to the edge and bring the other king up to help
+//
+static int evaluateKXK(const Position& position, int strongSide)
+{
+    int strongKing = kingSquare(position, strongSide);
+    int weakKing = kingSquare(position, strongSide ^ 1);
+    int score = SCORE_KNOWN_WIN + pieceMaterial(position, strongSide) + 20 * centreDistance(weakKing) + 10 * (7 - distance(strongKing, weakKing));
+    return strongSide == WHITE ? score : -score;
+}
+
+//
+// King and pawn against king, once the bitbase has said it is won: all that is left is to push
+// the pawn
+//
+static int evaluateKPK(const Position& position, int strongSide)
+{
+    int pawn = 0;
+    Bitboard(position.getBitboard(strongSide == WHITE ? WHITE_PAWNS : BLACK_PAWNS)).forEachBit([&](int s) { pawn = s; });
+    int rank = strongSide == WHITE ? pawn >> 3 : 7 - (pawn >> 3);
+    int score = SCORE_KNOWN_WIN + Evaluation::EndgameValues[0] + 20 * rank;
+    return strongSide == WHITE ? score : -score;
+}
+
+//
+// King, bishop and knight against a lone king: mate only happens in a corner the bishop covers,
+// so drive the defending king towards the nearer of those two
+//
+static int evaluateKBNK(const Position& position, int strongSide)
+{
+    int strongKing = kingSquare(position, strongSide);
+    int weakKing = kingSquare(position, strongSide ^ 1);
+    int bishop = 0;
+    Bitboard(position.getBitboard(strongSide == WHITE ? WHITE_BISHOPS : BLACK_BISHOPS)).forEachBit([&](int s) { bishop = s; });
+
+    // a1 is a dark square, so a dark squared bishop mates on a1 or h8 and a light one on h1 or a8
+    bool lightBishop = ((bishop & 7) + (bishop >> 3)) & 1;
+    int cornerA = lightBishop ? 7 : 0;
+    int cornerB = lightBishop ? 56 : 63;
+    int cornerDistance = std::min(std::abs((weakKing & 7) - (cornerA & 7)) + std::abs((weakKing >> 3) - (cornerA >> 3)),
+                                  std::abs((weakKing & 7) - (cornerB & 7)) + std::abs((weakKing >> 3) - (cornerB >> 3)));
+    int score = SCORE_KNOWN_WIN + 20 * (14 - cornerDistance) + 10 * (7 - distance(strongKing, weakKing));
+    return strongSide == WHITE ? score : -score;
+}
+
+MaterialTable::MaterialTable()
+    : _entries(ENTRIES)
+{
+    clear();
+}
+
+void MaterialTable::clear()
+{
+    // No position has a material key of 0 (there are always kings), so zeroed entries never match
+    for (Entry& entry : _entries) entry = Entry();
+}
+
+bool MaterialTable::bitbaseWins(const Position& position, const Entry& entry)
+{
+    int strong = entry.strongSide;
+    int base = strong == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    int piece = 0;
+    Bitboard(position.getBitboard(base) | position.getBitboard(base + Rook - Pawn) | position.getBitboard(base + Queen - Pawn)).forEachBit([&](int s) { piece = s; });
+    return Bitbases::probe((Bitbases::Ending)entry.bitbase, strong, position.getSideToMove(), kingSquare(position, strong), kingSquare(position, strong ^ 1), piece);
+}
+
+const MaterialTable::Entry& MaterialTable::probe(const Position& position)
+{
+    uint64_t key = position.getMaterialKey();
+    // The signature's bits are clustered, so multiply them together before taking the top 13
+    static_assert(ENTRIES == 1 << 13, "index takes 13 bits");
+    Entry& entry = _entries[(key * 0x9E3779B97F4A7C15ULL) >> 51];
+    if (entry.key != key) analyse(position, entry);
+    return entry;
+}
+
+void MaterialTable::analyse(const Position& position, Entry& entry)
+{
+    entry = Entry();
+    entry.key = position.getMaterialKey();
+    entry.scale[WHITE] = entry.scale[BLACK] = SCALE_NORMAL;
+
+    int pawns[2], knights[2], bishops[2], rooks[2], queens[2], material[2];
+    for (int color = WHITE; color <= BLACK; color++)
+    {
+        int base = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+        pawns[color] = position.pieceCount(base);
+        knights[color] = position.pieceCount(base + Knight - Pawn);
+        bishops[color] = position.pieceCount(base + Bishop - Pawn);
+        rooks[color] = position.pieceCount(base + Rook - Pawn);
+        queens[color] = position.pieceCount(base + Queen - Pawn);
+        material[color] = pieceMaterial(position, color);
+    }
+
+    int imbalance[2];
+    for (int color = WHITE; color <= BLACK; color++)
+    {
+        imbalance[color] = (bishops[color] >= 2 ? BishopPair : 0) +
+                           (pawns[color] - ImbalancePawns) * (knights[color] * KnightPerPawn + rooks[color] * RookPerPawn);
+    }
+    entry.imbalance = (int16_t)(imbalance[WHITE] - imbalance[BLACK]);
+
+    // A lone minor piece (or nothing at all) can't mate, and neither can the other king
+    int pieces = knights[WHITE] + bishops[WHITE] + rooks[WHITE] + queens[WHITE] +
+                 knights[BLACK] + bishops[BLACK] + rooks[BLACK] + queens[BLACK];
+    if (pawns[WHITE] + pawns[BLACK] == 0 && pieces - knights[WHITE] - bishops[WHITE] - knights[BLACK] - bishops[BLACK] == 0 && pieces <= 1)
+    {
+        entry.drawn = true;
+        entry.scale[WHITE] = entry.scale[BLACK] = 0;
+        return;
+    }
+
+    for (int strong = WHITE; strong <= BLACK; strong++)
+    {
+        int weak = strong ^ 1;
+        bool weakBare = pawns[weak] + knights[weak] + bishops[weak] + rooks[weak] + queens[weak] == 0;
+        int strongPieces = knights[strong] + bishops[strong] + rooks[strong] + queens[strong];
+
+        // Left to the ordinary evaluation until the bitbases have been built
+        if (weakBare && pawns[strong] == 1 && strongPieces == 0 && Bitbases::isReady())
+        {
+            entry.evaluator = evaluateKPK;
+            entry.bitbase = Bitbases::KPK;
+            entry.strongSide = (uint8_t)strong;
+            return;
+        }
+
+        if (weakBare && pawns[strong] == 0)
+        {
+            // Knights alone can't force mate; everything else with a rook's worth or more can
+            if (knights[strong] == 1 && bishops[strong] == 1 && rooks[strong] + queens[strong] == 0)
+            {
+                entry.evaluator = evaluateKBNK;
+                entry.strongSide = (uint8_t)strong;
+                return;
+            }
+            if (rooks[strong] + queens[strong] > 0 || bishops[strong] >= 2 || (bishops[strong] >= 1 && knights[strong] >= 2))
+            {
+                entry.evaluator = evaluateKXK;
+                entry.strongSide = (uint8_t)strong;
+                // A lone rook or queen can still be lost straight away, or stalemate the king
+                if (strongPieces == 1 && bishops[strong] == 0 && Bitbases::isReady()) entry.bitbase = (int8_t)(rooks[strong] ? Bitbases::KRK : Bitbases::KQK);
+                return;
+            }
+            if (bishops[strong] + rooks[strong] + queens[strong] == 0) entry.scale[strong] = 0;
+        }
+
+        // Without pawns, a side less than a rook up can rarely win, and a minor piece up almost never
+        if (pawns[strong] == 0 && material[strong] - material[weak] <= Evaluation::EndgameValues[Bishop - Pawn])
+        {
+            entry.scale[strong] = material[strong] < Evaluation::EndgameValues[Rook - Pawn] ? 0 : SCALE_NORMAL / 4;
+        }
+    }
+
+    entry.bishopsOnly = bishops[WHITE] == 1 && bishops[BLACK] == 1 &&
+                        knights[WHITE] + rooks[WHITE] + queens[WHITE] + knights[BLACK] + rooks[BLACK] + queens[BLACK] == 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Position.h"
+#include "Bitbases.h"
+#include <vector>
+
+// Scores a known ending on its own, in centipawns from white's point of view. strongSide is the
+// side with the winning material.
+typedef int (*EndgameEvaluator)(const Position& position, int strongSide);
+
+// Scale factors are out of SCALE_NORMAL; 0 means the side can't win however far ahead it looks
+constexpr int SCALE_NORMAL = 64;
+// Base score for a won ending, far above any material count but below the mate scores
+constexpr int SCORE_KNOWN_WIN = 10000;
+
+//
+// What follows from the material alone, cached by Position's material signature. There are only
+// a handful of material combinations in any search, so nearly every lookup hits, and the leaves
+// don't work out the imbalance or look for a known ending from piece counts each time.
+//
+// Each search thread has its own table, so it needs no locking.
+//
+class MaterialTable
+{
+public:
+    static constexpr size_t ENTRIES = 8192;
+
+    struct Entry
+    {
+        uint64_t key;
+        // Scores the whole position by itself when set (KRK, KQK, KBNK and the like)
+        EndgameEvaluator evaluator;
+        // The Bitbases::Ending that says whether a KPK, KRK or KQK position is won, -1 for none
+        int8_t bitbase = -1;
+        // Bishop pair, and knights and rooks gaining and losing value with the pawn count
+        int16_t imbalance;
+        uint8_t strongSide;
+        // How much of its advantage each side can hope to convert
+        uint8_t scale[2];
+        // Neither side has anything to mate with, so the game is a draw whatever happens
+        bool drawn;
+        // One bishop each and nothing else but pawns: scaled down further if the bishops turn
+        // out to be on opposite colors, which depends on the squares and not just the material
+        bool bishopsOnly;
+    };
+
+    MaterialTable();
+
+    const Entry& probe(const Position& position);
+    void clear();
+    // True if the entry's bitbase says the strong side wins this position
+    static bool bitbaseWins(const Position& position, const Entry& entry);
+
+private:
+    static void analyse(const Position& position, Entry& entry);
+
+    std::vector<Entry> _entries;
+};
@@ -0,0 +1,603 @@
+#include "MoveGenerator.h"
+#include "MagicBitboards.h"
+#include <algorithm>
+
+MoveGenerator::MoveGenerator()
+{
+    // Every attack table is compile-time data shared by all generators, this only picks how
+    // slider attacks are indexed, once per process
+    initMagicBitboards();
+}
+
+const char* MoveGenerator::sliderAttackBackend()
+{
+    return ::sliderAttackBackend();
+}
+
+// Shifts a bitboard towards rank 8 for a positive shift and towards rank 1 for a negative one
+template <int Shift>
+static inline uint64_t shiftBy(uint64_t bitboard)
+{
+    if constexpr (Shift > 0) return bitboard << Shift;
+    else return bitboard >> -Shift;
+}
+
+void MoveGenerator::addPawnBitboardMovesToList(MoveList& moves, const Bitboard bitboard, const int shift, const int flags, const PinMasks& pins) const
+{
+    if (bitboard.getData() == 0) return;
+
+    bitboard.forEachBit(
+        [&](int toSquare)
+        {
+            int fromSquare = toSquare - shift;
+            if (pins.maskFor(fromSquare) & (1ULL << toSquare)) moves.emplace_back(fromSquare, toSquare, flags);
+        }
+    );
+}
+
+// Adds all four promotions for each pawn move in the bitboard, queen first
+void MoveGenerator::addPawnPromotionsToList(MoveList& moves, const Bitboard bitboard, const int shift, const bool capture, const PinMasks& pins) const
+{
+    if (bitboard.getData() == 0) return;
+
+    int flags = capture ? MOVE_QUEEN_PROMOTION_CAPTURE : MOVE_QUEEN_PROMOTION;
+    bitboard.forEachBit(
+        [&](int toSquare)
+        {
+            int fromSquare = toSquare - shift;
+            if (!(pins.maskFor(fromSquare) & (1ULL << toSquare))) return;
+            for (int promotion = 0; promotion < 4; promotion++) moves.emplace_back(fromSquare, toSquare, flags - promotion);
+        }
+    );
+}
+
+//
+// Generates move objects for pawns from a bitboard, adding them to the moves list with addPawnBitboardMovesToList().
+// Promotions are counted with the captures, so the quiet moves are only pushes and double pushes.
+//
+template <int Color>
+void MoveGenerator::generatePawnMoves(MoveList& moves, Bitboard pawnBoard, Bitboard enemyPieces, Bitboard emptySquares, uint64_t targetSquares, GenType type, const PinMasks& pins) const
+{
+    if (pawnBoard.getData() == 0) return;
+
+    // Constants for ranks and files
+    constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask (left edge)
+    constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask (right edge)
+    constexpr uint64_t Rank1And8(0xFF000000000000FFULL); // Promotion ranks
+    // One space ahead of the starting rank (rank 3 for white, rank 6 for black)
+    constexpr uint64_t PushedOnce = Color == WHITE ? 0x0000000000FF0000ULL : 0x0000FF0000000000ULL;
+
+    // Forward and the two capture directions, as square offsets
+    constexpr int singleShift = Color == WHITE ? 8 : -8;
+    constexpr int doubleShift = 2 * singleShift;
+    constexpr int captureLeftShift = Color == WHITE ? 7 : -9;
+    constexpr int captureRightShift = Color == WHITE ? 9 : -7;
+
+    // Calculate single pawn moves forward
+    Bitboard singleMoves = shiftBy<singleShift>(pawnBoard.getData()) & emptySquares.getData();
+    // Calculate double pawn moves from the starting rank
+    Bitboard doubleMoves = shiftBy<singleShift>(singleMoves.getData() & PushedOnce) & emptySquares.getData();
+    // Calculate left and right pawn captures
+    Bitboard capturesLeft = shiftBy<captureLeftShift>(pawnBoard.getData() & NotAFile) & enemyPieces.getData();
+    Bitboard capturesRight = shiftBy<captureRightShift>(pawnBoard.getData() & NotHFile) & enemyPieces.getData();
+
+    // Only keep moves that resolve a check, if there is one
+    singleMoves = singleMoves.getData() & targetSquares;
+    doubleMoves = doubleMoves.getData() & targetSquares;
+    capturesLeft = capturesLeft.getData() & targetSquares;
+    capturesRight = capturesRight.getData() & targetSquares;
+
+    // Add all calculated moves to the move list
+    if (type != GEN_QUIETS)
+    {
+        addPawnPromotionsToList(moves, singleMoves.getData() & Rank1And8, singleShift, false, pins);
+        addPawnPromotionsToList(moves, capturesLeft.getData() & Rank1And8, captureLeftShift, true, pins);
+        addPawnPromotionsToList(moves, capturesRight.getData() & Rank1And8, captureRightShift, true, pins);
+        addPawnBitboardMovesToList(moves, capturesLeft.getData() & ~Rank1And8, captureLeftShift, MOVE_CAPTURE, pins);
+        addPawnBitboardMovesToList(moves, capturesRight.getData() & ~Rank1And8, captureRightShift, MOVE_CAPTURE, pins);
+    }
+    if (type != GEN_CAPTURES)
+    {
+        addPawnBitboardMovesToList(moves, singleMoves.getData() & ~Rank1And8, singleShift, MOVE_QUIET, pins);
+        addPawnBitboardMovesToList(moves, doubleMoves, doubleShift, MOVE_DOUBLE_PUSH, pins);
+    }
+}
+
+//
+// En passant can't go through the pin and check masks: taking the pawn beside the king can
+// uncover an attack along the rank, and the pawn it removes may be the one giving check. So each
+// one is tested directly by looking at the king with the move made.
+//
+template <int Color>
+void MoveGenerator::generateEnPassantMoves(MoveList& moves, const Position& position, uint64_t myPawns, uint64_t myKing, uint64_t occupied, uint64_t enemySquares) const
+{
+    int epSquare = position.getEnPassantSquare();
+    if (epSquare == NO_SQUARE) return;
+
+    uint64_t epBit = 1ULL << epSquare;
+    int capturedSquare = Color == WHITE ? epSquare - 8 : epSquare + 8;
+    uint64_t capturedBit = 1ULL << capturedSquare;
+    // Our pawns that attack the square are the ones an enemy pawn there would attack
+    uint64_t attackers;
+    if constexpr (Color == WHITE) attackers = BLACK_PAWN_ATTACKS(epBit) & myPawns;
+    else attackers = WHITE_PAWN_ATTACKS(epBit) & myPawns;
+
+    Bitboard(attackers).forEachBit(
+        [&](int fromSquare)
+        {
+            if (myKing)
+            {
+                uint64_t occupiedAfter = (occupied ^ (1ULL << fromSquare) ^ capturedBit) | epBit;
+                if (attackersTo(position, getFirstBit(myKing), occupiedAfter) & enemySquares & ~capturedBit) return;
+            }
+            moves.emplace_back(fromSquare, epSquare, MOVE_EN_PASSANT);
+        }
+    );
+}
+
+//
+// Castling: the right must still be there, the squares between king and rook empty, and the king
+// may not be in check, pass through an attacked square or land on one
+//
+template <int Color>
+void MoveGenerator::generateCastlingMoves(MoveList& moves, const Position& position, uint64_t occupied, uint64_t enemyAttacks) const
+{
+    constexpr int kingSquare = Color == WHITE ? 4 : 60;
+    constexpr int kingside = Color == WHITE ? WHITE_KINGSIDE : BLACK_KINGSIDE;
+    constexpr int queenside = Color == WHITE ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+    int rights = position.getCastlingRights();
+    if (!(rights & (kingside | queenside))) return;
+    if (!(position.getBitboard(Color == WHITE ? WHITE_KING : BLACK_KING) & (1ULL << kingSquare))) return;
+
+    uint64_t rooks = position.getBitboard(Color == WHITE ? WHITE_ROOKS : BLACK_ROOKS);
+    if ((rights & kingside) && (rooks & (1ULL << (kingSquare + 3))))
+    {
+        constexpr uint64_t between = 3ULL << (kingSquare + 1);
+        if (!(occupied & between) && !(enemyAttacks & between)) moves.emplace_back(kingSquare, kingSquare + 2, MOVE_KING_CASTLE);
+    }
+    if ((rights & queenside) && (rooks & (1ULL << (kingSquare - 4))))
+    {
+        constexpr uint64_t between = 7ULL << (kingSquare - 3);
+        constexpr uint64_t kingPath = 3ULL << (kingSquare - 2);
+        if (!(occupied & between) && !(enemyAttacks & kingPath)) moves.emplace_back(kingSquare, kingSquare - 2, MOVE_QUEEN_CASTLE);
+    }
+}
+
+//
+// Generates move objects for knights from a bitboard
+//
+void MoveGenerator::generateKnightMoves(MoveList& moves, Bitboard knightBoard, uint64_t movableSquares, uint64_t enemySquares, const PinMasks& pins) const
+{
+    knightBoard.forEachBit(
+        [&](int fromSquare) 
+        {
+            Bitboard moveBitboard = Bitboard(KnightAttacks[fromSquare] & movableSquares & pins.maskFor(fromSquare));
+            moveBitboard.forEachBit(
+                [&](int toSquare) 
+                { 
+                    moves.emplace_back(fromSquare, toSquare, captureFlag(enemySquares, toSquare)); 
+                }
+            ); 
+        }
+    );
+}
+
+void MoveGenerator::generateKingMoves(MoveList& moves, Bitboard kingBoard, uint64_t movableSquares, uint64_t enemySquares) const
+{
+    kingBoard.forEachBit(
+        [&](int fromSquare) 
+        {
+            Bitboard moveBitboard = Bitboard(KingAttacks[fromSquare] & movableSquares);
+            moveBitboard.forEachBit(
+                [&](int toSquare) 
+                { 
+                    moves.emplace_back(fromSquare, toSquare, captureFlag(enemySquares, toSquare)); 
+                }
+            ); 
+        }
+    );
+}
+
+void MoveGenerator::generateRookMoves(MoveList& moves, Bitboard rookBoard, uint64_t occupiedSquares, uint64_t friendlySquares, uint64_t enemySquares, const PinMasks& pins) const
+{
+    rookBoard.forEachBit(
+        [&](int fromSquare)
+        {
+            Bitboard moveBitboard = Bitboard(getRookAttacks(fromSquare, occupiedSquares) & friendlySquares & pins.maskFor(fromSquare));
+            moveBitboard.forEachBit(
+                [&](int toSquare) 
+                { 
+                    moves.emplace_back(fromSquare, toSquare, captureFlag(enemySquares, toSquare)); 
+                }
+            ); 
+        }
+    );
+}
+
+void MoveGenerator::generateBishopMoves(MoveList& moves, Bitboard bishopBoard, uint64_t occupiedSquares, uint64_t friendlySquares, uint64_t enemySquares, const PinMasks& pins) const
+{
+    bishopBoard.forEachBit(
+        [&](int fromSquare)
+        {
+            Bitboard moveBitboard = Bitboard(getBishopAttacks(fromSquare, occupiedSquares) & friendlySquares & pins.maskFor(fromSquare));
+            moveBitboard.forEachBit(
+                [&](int toSquare) 
+                { 
+                    moves.emplace_back(fromSquare, toSquare, captureFlag(enemySquares, toSquare)); 
+                }
+            ); 
+        }
+    );
+}
+
+void MoveGenerator::generateQueenMoves(MoveList& moves, Bitboard queenBoard, uint64_t occupiedSquares, uint64_t friendlySquares, uint64_t enemySquares, const PinMasks& pins) const
+{
+    queenBoard.forEachBit(
+        [&](int fromSquare)
+        {
+            Bitboard moveBitboard = Bitboard(getQueenAttacks(fromSquare, occupiedSquares) & friendlySquares & pins.maskFor(fromSquare));
+            moveBitboard.forEachBit(
+                [&](int toSquare) 
+                { 
+                    moves.emplace_back(fromSquare, toSquare, captureFlag(enemySquares, toSquare)); 
+                }
+            ); 
+        }
+    );
+}
+
+//
+// Returns every square attacked by the given color with the given occupancy
+//
+template <int Color>
+uint64_t MoveGenerator::attackedSquares(const Position& position, uint64_t occupied)
+{
+    constexpr int base = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    uint64_t pawns = position.getBitboard(base + WHITE_PAWNS);
+    uint64_t attacks;
+    if constexpr (Color == WHITE) attacks = WHITE_PAWN_ATTACKS(pawns);
+    else attacks = BLACK_PAWN_ATTACKS(pawns);
+
+    Bitboard(position.getBitboard(base + WHITE_KNIGHTS)).forEachBit([&](int square) { attacks |= KnightAttacks[square]; });
+    Bitboard(position.getBitboard(base + WHITE_KING)).forEachBit([&](int square) { attacks |= KingAttacks[square]; });
+
+    // All the sliders at once rather than a lookup per piece
+    uint64_t queens = position.getBitboard(base + WHITE_QUEENS);
+    attacks |= getSliderAttacksSetwise(position.getBitboard(base + WHITE_ROOKS) | queens, position.getBitboard(base + WHITE_BISHOPS) | queens, occupied);
+
+    return attacks;
+}
+
+//
+// Returns the pieces of both colors that attack a square with the given occupancy
+//
+uint64_t MoveGenerator::attackersTo(const Position& position, int square, uint64_t occupied)
+{
+    uint64_t bishopsQueens = position.getBitboard(WHITE_BISHOPS) | position.getBitboard(BLACK_BISHOPS) |
+                             position.getBitboard(WHITE_QUEENS) | position.getBitboard(BLACK_QUEENS);
+    uint64_t rooksQueens = position.getBitboard(WHITE_ROOKS) | position.getBitboard(BLACK_ROOKS) |
+                           position.getBitboard(WHITE_QUEENS) | position.getBitboard(BLACK_QUEENS);
+    uint64_t squareBit = 1ULL << square;
+
+    // A white pawn attacks this square if a black pawn standing here would attack it, and vice versa
+    return (BLACK_PAWN_ATTACKS(squareBit) & position.getBitboard(WHITE_PAWNS)) |
+           (WHITE_PAWN_ATTACKS(squareBit) & position.getBitboard(BLACK_PAWNS)) |
+           (KnightAttacks[square] & (position.getBitboard(WHITE_KNIGHTS) | position.getBitboard(BLACK_KNIGHTS))) |
+           (KingAttacks[square] & (position.getBitboard(WHITE_KING) | position.getBitboard(BLACK_KING))) |
+           (getBishopAttacks(square, occupied) & bishopsQueens) |
+           (getRookAttacks(square, occupied) & rooksQueens);
+}
+
+//
+// Checks a move that didn't come from this position's move list, such as a hash or killer move,
+// without generating the whole list: the piece must be ours, able to reach the square, and must
+// not leave our king attacked
+//
+bool MoveGenerator::isLegal(const Position& position, const BitMove& move) const
+{
+    if (move.isNull()) return false;
+
+    int color = position.getSideToMove();
+    int myBitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    int enemyBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    int pieceIndex = position.pieceOn(move.from);
+    if (pieceIndex < myBitIndex || pieceIndex >= myBitIndex + WHITE_ALL) return false;
+    int piece = pieceIndex - myBitIndex + Pawn;
+
+    // Castling and en passant have conditions of their own and are rare, so just generate them
+    if (move.isCastle() || move.isEnPassant())
+    {
+        MoveList moves;
+        generateMoves(position, moves);
+        for (auto const & legal : moves) if (legal == move) return true;
+        return false;
+    }
+
+    uint64_t fromBit = 1ULL << move.from;
+    uint64_t toBit = 1ULL << move.to;
+    uint64_t occupiedByMe = position.getBitboard(WHITE_ALL + myBitIndex);
+    uint64_t occupiedByEnemy = position.getBitboard(WHITE_ALL + enemyBitIndex);
+    uint64_t occupied = occupiedByMe | occupiedByEnemy;
+    if (toBit & occupiedByMe) return false;
+
+    // The flags have to agree with the board
+    constexpr uint64_t Rank1And8(0xFF000000000000FFULL);
+    bool pawnToLastRank = piece == Pawn && (toBit & Rank1And8);
+    if (move.isCapture() != ((toBit & occupiedByEnemy) != 0)) return false;
+    if (move.isPromotion() != pawnToLastRank) return false;
+    if ((move.flags == MOVE_DOUBLE_PUSH) != (piece == Pawn && (move.to - move.from == 16 || move.from - move.to == 16))) return false;
+
+    uint64_t reach = 0ULL;
+    switch (piece)
+    {
+    case Pawn:
+    {
+        constexpr uint64_t Rank3(0x0000000000FF0000ULL);
+        constexpr uint64_t Rank6(0x0000FF0000000000ULL);
+        uint64_t single = (color == WHITE ? fromBit << 8 : fromBit >> 8) & ~occupied;
+        uint64_t twice = (color == WHITE ? (single & Rank3) << 8 : (single & Rank6) >> 8) & ~occupied;
+        uint64_t captures = (color == WHITE ? WHITE_PAWN_ATTACKS(fromBit) : BLACK_PAWN_ATTACKS(fromBit)) & occupiedByEnemy;
+        reach = single | twice | captures;
+        break;
+    }
+    case Knight: reach = KnightAttacks[move.from]; break;
+    case Bishop: reach = getBishopAttacks(move.from, occupied); break;
+    case Rook:   reach = getRookAttacks(move.from, occupied); break;
+    case Queen:  reach = getQueenAttacks(move.from, occupied); break;
+    case King:   reach = KingAttacks[move.from]; break;
+    }
+    if (!(reach & toBit)) return false;
+
+    uint64_t myKing = position.getBitboard(WHITE_KING + myBitIndex);
+    if (!myKing) return true;
+
+    // Look at the king's square with the move made; a captured piece no longer attacks anything
+    int kingSquare = piece == King ? move.to : getFirstBit(myKing);
+    uint64_t occupiedAfter = (occupied & ~fromBit) | toBit;
+    return (attackersTo(position, kingSquare, occupiedAfter) & occupiedByEnemy & ~toBit) == 0;
+}
+
+//
+// Static exchange evaluation: the material the side to move comes out with if both sides keep
+// recapturing on the move's target square, least valuable attacker first, and either side may
+// stop when carrying on would lose more. Sliders hidden behind a piece that has captured join in
+// as they are uncovered. Pins are not taken into account.
+//
+int MoveGenerator::see(const Position& position, const BitMove& move) const
+{
+    static const int SeeValues[7] = { 0, 100, 320, 330, 500, 900, 20000 };
+
+    int to = move.to;
+    int victim = position.pieceOn(to);
+    int gain[32];
+    int depth = 0;
+    gain[0] = victim == EMPTY_SQUARES ? 0 : SeeValues[victim % 7 + 1];
+
+    uint64_t occupied = position.getOccupied() ^ (1ULL << move.from);
+    if (move.isEnPassant())
+    {
+        gain[0] = SeeValues[Pawn];
+        occupied ^= 1ULL << (position.getSideToMove() == WHITE ? to - 8 : to + 8);
+    }
+    uint64_t bishopsQueens = position.getBitboard(WHITE_BISHOPS) | position.getBitboard(BLACK_BISHOPS) |
+                             position.getBitboard(WHITE_QUEENS) | position.getBitboard(BLACK_QUEENS);
+    uint64_t rooksQueens = position.getBitboard(WHITE_ROOKS) | position.getBitboard(BLACK_ROOKS) |
+                           position.getBitboard(WHITE_QUEENS) | position.getBitboard(BLACK_QUEENS);
+    uint64_t attackers = attackersTo(position, to, occupied) & occupied;
+
+    int pieceOnSquare = position.pieceOn(move.from) % 7 + 1;
+    int side = position.getSideToMove() ^ 1;
+
+    while (true)
+    {
+        // The side to recapture uses its least valuable attacker
+        int base = side == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+        uint64_t sideAttackers = attackers & position.getBitboard(base + WHITE_ALL);
+        if (!sideAttackers) break;
+
+        int piece = Pawn;
+        uint64_t from = 0ULL;
+        for (; piece <= King; piece++)
+        {
+            from = sideAttackers & position.getBitboard(base + piece - 1);
+            if (from) break;
+        }
+        // The king can't recapture into an attack
+        if (piece == King && (attackers & ~sideAttackers)) break;
+
+        depth++;
+        gain[depth] = SeeValues[pieceOnSquare] - gain[depth - 1];
+        pieceOnSquare = piece;
+        if (depth == 31) break;
+
+        occupied ^= from & (0 - from);
+        attackers &= occupied;
+        if (piece == Pawn || piece == Bishop || piece == Queen) attackers |= getBishopAttacks(to, occupied) & bishopsQueens & occupied;
+        if (piece == Rook || piece == Queen) attackers |= getRookAttacks(to, occupied) & rooksQueens & occupied;
+        side ^= 1;
+    }
+
+    // Each side only carries on with the exchange if it doesn't lose by it
+    for (; depth > 0; depth--) gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+    return gain[0];
+}
+
+bool MoveGenerator::isInCheck(const Position& position) const
+{
+    return position.inCheck();
+}
+
+void MoveGenerator::computeAttacks(const Position& position, uint64_t attacks[2], uint64_t& checkers)
+{
+    uint64_t occupied = position.getOccupied();
+    attacks[WHITE] = attackedSquares<WHITE>(position, occupied);
+    attacks[BLACK] = attackedSquares<BLACK>(position, occupied);
+
+    // Only look for the checkers when the king's square is attacked at all
+    int us = position.getSideToMove();
+    uint64_t king = position.getBitboard(us == WHITE ? WHITE_KING : BLACK_KING);
+    checkers = 0ULL;
+    if (king & attacks[us ^ 1]) checkers = attackersTo(position, getFirstBit(king), occupied) & position.getBitboard(us == WHITE ? BLACK_ALL : WHITE_ALL);
+}
+
+uint64_t MoveGenerator::pieceAttacks(int piece, int square, uint64_t occupied)
+{
+    switch (piece)
+    {
+    case Knight: return KnightAttacks[square];
+    case Bishop: return getBishopAttacks(square, occupied);
+    case Rook: return getRookAttacks(square, occupied);
+    case Queen: return getQueenAttacks(square, occupied);
+    case King: return KingAttacks[square];
+    default: return 0ULL;
+    }
+}
+
+//
+// Finds the pieces of the given color pinned to their king and sets each one's pin mask to the
+// ray it may still move along (up to and including the pinning piece)
+//
+template <int Color>
+void MoveGenerator::findPins(const Position& position, int kingSquare, uint64_t friendlySquares, uint64_t enemySquares, PinMasks& pins) const
+{
+    constexpr int enemyBase = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    uint64_t enemyQueens = position.getBitboard(enemyBase + WHITE_QUEENS);
+
+    // Enemy sliders that would attack the king if our own pieces were not in the way
+    uint64_t pinners = (getRookAttacks(kingSquare, enemySquares) & (position.getBitboard(enemyBase + WHITE_ROOKS) | enemyQueens)) |
+                       (getBishopAttacks(kingSquare, enemySquares) & (position.getBitboard(enemyBase + WHITE_BISHOPS) | enemyQueens));
+
+    Bitboard(pinners).forEachBit(
+        [&](int pinnerSquare)
+        {
+            uint64_t ray = BetweenBitboards[kingSquare][pinnerSquare];
+            uint64_t blockers = ray & friendlySquares;
+            // exactly one of our pieces in between, and nothing of theirs
+            if (blockers && !(blockers & (blockers - 1)) && !(ray & enemySquares))
+            {
+                pins.pinned |= blockers;
+                pins.rays[getFirstBit(blockers)] = ray | (1ULL << pinnerSquare);
+            }
+        }
+    );
+}
+
+//
+// Generates all legal moves for a given player. Checkers, the check evasion mask and the pin
+// masks are worked out once up front, so each move only needs to be ANDed against them.
+//
+void MoveGenerator::generateMoves(const Position& position, MoveList& moves) const
+{
+    LegalInfo info;
+    if (position.getSideToMove() == WHITE)
+    {
+        computeLegalInfo<WHITE>(position, info);
+        generate<WHITE>(position, info, GEN_ALL, moves);
+    }
+    else
+    {
+        computeLegalInfo<BLACK>(position, info);
+        generate<BLACK>(position, info, GEN_ALL, moves);
+    }
+}
+
+void MoveGenerator::computeLegalInfo(const Position& position, LegalInfo& info) const
+{
+    if (position.getSideToMove() == WHITE) computeLegalInfo<WHITE>(position, info);
+    else computeLegalInfo<BLACK>(position, info);
+}
+
+void MoveGenerator::generateCaptures(const Position& position, const LegalInfo& info, MoveList& moves) const
+{
+    if (position.getSideToMove() == WHITE) generate<WHITE>(position, info, GEN_CAPTURES, moves);
+    else generate<BLACK>(position, info, GEN_CAPTURES, moves);
+}
+
+void MoveGenerator::generateQuiets(const Position& position, const LegalInfo& info, MoveList& moves) const
+{
+    if (position.getSideToMove() == WHITE) generate<WHITE>(position, info, GEN_QUIETS, moves);
+    else generate<BLACK>(position, info, GEN_QUIETS, moves);
+}
+
+//
+// Works out the checkers, the check evasion mask and the pin masks for the side to move
+//
+template <int Color>
+void MoveGenerator::computeLegalInfo(const Position& position, LegalInfo& info) const
+{
+    constexpr int myBitIndex = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    constexpr int enemyBitIndex = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+
+    uint64_t myKing = position.getBitboard(WHITE_KING + myBitIndex);
+    uint64_t occupiedByEnemy = position.getBitboard(WHITE_ALL + enemyBitIndex);
+    uint64_t occupiedByMe = position.getBitboard(WHITE_ALL + myBitIndex);
+    uint64_t occupied = occupiedByMe | occupiedByEnemy;
+
+    // The king may not step onto an attacked square. The position's attack map does for that
+    // unless the king is in check: then it has to be taken off the board, so that it can't hide
+    // behind itself when stepping away from a slider.
+    uint64_t checkers = position.getCheckers();
+    info.enemyAttacks = checkers ? attackedSquares<Color ^ 1>(position, occupied & ~myKing) : position.getAttacks(Color ^ 1);
+
+    // Without a king there is nothing to keep safe, so fall back to every pseudo-legal move
+    info.checkMask = ~0ULL;
+    info.checkers = 0ULL;
+    info.doubleCheck = false;
+    info.pins.pinned = 0ULL;
+    if (!myKing) return;
+
+    int kingSquare = getFirstBit(myKing);
+    info.checkers = checkers;
+
+    // In double check only the king can move
+    if (checkers & (checkers - 1))
+    {
+        info.doubleCheck = true;
+        return;
+    }
+
+    // In single check other pieces must capture the checker or block it
+    if (checkers) info.checkMask = checkers | BetweenBitboards[kingSquare][getFirstBit(checkers)];
+
+    findPins<Color>(position, kingSquare, occupiedByMe, occupiedByEnemy, info.pins);
+}
+
+//
+// Fills the list with the legal moves of one kind for the side to move. Checkers, the check evasion mask and
+// the pin masks are worked out once up front, so each move only needs to be ANDed against them.
+//
+template <int Color>
+void MoveGenerator::generate(const Position& position, const LegalInfo& info, GenType type, MoveList& moves) const
+{
+    moves.clear();
+
+    constexpr int myBitIndex = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    constexpr int enemyBitIndex = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+
+    uint64_t myPawns = position.getBitboard(WHITE_PAWNS + myBitIndex);
+    uint64_t myKnights = position.getBitboard(WHITE_KNIGHTS + myBitIndex);
+    uint64_t myBishops = position.getBitboard(WHITE_BISHOPS + myBitIndex);
+    uint64_t myRooks = position.getBitboard(WHITE_ROOKS + myBitIndex);
+    uint64_t myQueens = position.getBitboard(WHITE_QUEENS + myBitIndex);
+    uint64_t myKing = position.getBitboard(WHITE_KING + myBitIndex);
+    
+    uint64_t occupiedByEnemy = position.getBitboard(WHITE_ALL + enemyBitIndex);
+    uint64_t occupiedByMe = position.getBitboard(WHITE_ALL + myBitIndex);
+    uint64_t occupied = occupiedByMe | occupiedByEnemy;
+
+    // Captures only land on enemy pieces and quiet moves only on empty squares
+    uint64_t targets = type == GEN_CAPTURES ? occupiedByEnemy : (type == GEN_QUIETS ? ~occupied : ~occupiedByMe);
+
+    if (!info.doubleCheck)
+    {
+        uint64_t checkMask = info.checkMask;
+        generatePawnMoves<Color>(moves, myPawns, occupiedByEnemy, ~occupied, checkMask, type, info.pins);
+        if (type != GEN_QUIETS) generateEnPassantMoves<Color>(moves, position, myPawns, myKing, occupied, occupiedByEnemy);
+        generateKnightMoves(moves, myKnights, targets & checkMask, occupiedByEnemy, info.pins);
+        generateBishopMoves(moves, myBishops, occupied, targets & checkMask, occupiedByEnemy, info.pins);
+        generateRookMoves(moves, myRooks, occupied, targets & checkMask, occupiedByEnemy, info.pins);
+        generateQueenMoves(moves, myQueens, occupied, targets & checkMask, occupiedByEnemy, info.pins);
+    }
+    generateKingMoves(moves, myKing, targets & ~info.enemyAttacks, occupiedByEnemy);
+    if (type != GEN_CAPTURES && !info.checkers) generateCastlingMoves<Color>(moves, position, occupied, info.enemyAttacks);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Position.h"
+#include "MoveList.h"
+
+//
+// Chess move generation on bitboards. This has no dependencies on the Game/Grid/ImGui side
+// of the project so it can be driven headless (see perft.cpp) as well as from Chess.
+//
+class MoveGenerator
+{
+public:
+    // Pinned pieces and the rays they may still move along, worked out per call so nothing is
+    // written to the generator itself
+    struct PinMasks
+    {
+        uint64_t pinned = 0ULL;
+        uint64_t rays[64];
+        uint64_t maskFor(int square) const { return (pinned >> square) & 1 ? rays[square] : ~0ULL; }
+    };
+
+    // What legal generation needs to know about the side to move's king, worked out once per
+    // position and shared by each stage of a staged generation
+    struct LegalInfo
+    {
+        uint64_t enemyAttacks;
+        uint64_t checkers;
+        uint64_t checkMask;
+        bool doubleCheck;
+        PinMasks pins;
+    };
+
+    // Cheap to make, any number of generators (and threads) share the same read-only tables
+    MoveGenerator();
+
+    // Generates all legal moves for the side to move. Safe to call from several threads at once.
+    void generateMoves(const Position& position, MoveList& moves) const;
+    // Staged generation: computeLegalInfo once, then generateCaptures without building any quiet
+    // moves, and generateQuiets for the non-captures it left out only if they are needed
+    void computeLegalInfo(const Position& position, LegalInfo& info) const;
+    void generateCaptures(const Position& position, const LegalInfo& info, MoveList& moves) const;
+    void generateQuiets(const Position& position, const LegalInfo& info, MoveList& moves) const;
+    // True if a move from somewhere else (hash table, killers) is legal in this position
+    bool isLegal(const Position& position, const BitMove& move) const;
+    // Static exchange evaluation of a capture, in centipawns for the side making it
+    int see(const Position& position, const BitMove& move) const;
+    // True if the side to move's king is attacked
+    bool isInCheck(const Position& position) const;
+    // How rook and bishop attacks are looked up on this machine, picked at startup from the CPU
+    static const char* sliderAttackBackend();
+    // Squares attacked by each side and the enemy pieces checking the side to move's king. The
+    // attack tables live here, so Position keeps its attack maps up to date through this.
+    static void computeAttacks(const Position& position, uint64_t attacks[2], uint64_t& checkers);
+    // Squares a knight, bishop, rook, queen or king (a ChessPiece) attacks from a square with the
+    // given squares occupied, for code outside move generation that needs the same tables
+    static uint64_t pieceAttacks(int piece, int square, uint64_t occupied);
+
+private:
+    enum GenType
+    {
+        GEN_ALL,
+        GEN_CAPTURES,
+        GEN_QUIETS
+    };
+
+    // Everything that depends on the side to move is templated on it (WHITE or BLACK), so shifts,
+    // ranks and bitboard indices are compile-time constants. The public functions above pick the
+    // instantiation once from position.getSideToMove().
+    template <int Color> void computeLegalInfo(const Position& position, LegalInfo& info) const;
+    template <int Color> void generate(const Position& position, const LegalInfo& info, GenType type, MoveList& moves) const;
+    void addPawnBitboardMovesToList(MoveList& moves, const Bitboard bitboard, const int shift, const int flags, const PinMasks& pins) const;
+    void addPawnPromotionsToList(MoveList& moves, const Bitboard bitboard, const int shift, const bool capture, const PinMasks& pins) const;
+    template <int Color> void generatePawnMoves(MoveList& moves, Bitboard pawnBoard, Bitboard enemyPieces, Bitboard emptySquares, uint64_t targetSquares, GenType type, const PinMasks& pins) const;
+    template <int Color> void generateEnPassantMoves(MoveList& moves, const Position& position, uint64_t myPawns, uint64_t myKing, uint64_t occupied, uint64_t enemySquares) const;
+    template <int Color> void generateCastlingMoves(MoveList& moves, const Position& position, uint64_t occupied, uint64_t enemyAttacks) const;
+    void generateKnightMoves(MoveList& moves, Bitboard knightBoard, uint64_t movableSquares, uint64_t enemySquares, const PinMasks& pins) const;
+    void generateKingMoves(MoveList& moves, Bitboard kingBoard, uint64_t movableSquares, uint64_t enemySquares) const;
+    void generateRookMoves(MoveList& moves, Bitboard rookBoard, uint64_t occupiedSquares, uint64_t friendlySquares, uint64_t enemySquares, const PinMasks& pins) const;
+    void generateBishopMoves(MoveList& moves, Bitboard bishopBoard, uint64_t occupiedSquares, uint64_t friendlySquares, uint64_t enemySquares, const PinMasks& pins) const;
+    void generateQueenMoves(MoveList& moves, Bitboard queenBoard, uint64_t occupiedSquares, uint64_t friendlySquares, uint64_t enemySquares, const PinMasks& pins) const;
+
+    // MOVE_CAPTURE if the square holds an enemy piece, otherwise MOVE_QUIET
+    static int captureFlag(uint64_t enemySquares, int square) { return (int)((enemySquares >> square) & 1) << 2; }
+
+    // Legality
+    template <int Color> static uint64_t attackedSquares(const Position& position, uint64_t occupied);
+    static uint64_t attackersTo(const Position& position, int square, uint64_t occupied);
+    template <int Color> void findPins(const Position& position, int kingSquare, uint64_t friendlySquares, uint64_t enemySquares, PinMasks& pins) const;
+};
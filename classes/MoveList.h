@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Bitboard.h"
+#include <cstddef>
+
+//
+// Fixed capacity move list that lives on the stack, so generating moves never touches the heap.
+// It has the parts of the std::vector interface move generation uses, plus an ordering score kept
+// alongside each move. No chess position has more than 218 legal moves, so 256 is always enough.
+//
+class MoveList
+{
+public:
+    static constexpr size_t MAX_MOVES = 256;
+
+    MoveList() : _size(0) { }
+
+    void emplace_back(int from, int to, int flags) { _moves[_size++] = BitMove(from, to, flags); }
+    void push_back(const BitMove& move) { _moves[_size++] = move; }
+    void clear() { _size = 0; }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    BitMove& operator[](size_t index) { return _moves[index]; }
+    const BitMove& operator[](size_t index) const { return _moves[index]; }
+    const BitMove& front() const { return _moves[0]; }
+
+    BitMove* begin() { return _moves; }
+    BitMove* end() { return _moves + _size; }
+    const BitMove* begin() const { return _moves; }
+    const BitMove* end() const { return _moves + _size; }
+
+    // Ordering score of the move at index, set by whoever is ordering the list
+    int& score(size_t index) { return _scores[index]; }
+    int score(size_t index) const { return _scores[index]; }
+
+    // Swaps two moves along with their scores
+    void swap(size_t a, size_t b)
+    {
+        BitMove move = _moves[a]; _moves[a] = _moves[b]; _moves[b] = move;
+        int score = _scores[a]; _scores[a] = _scores[b]; _scores[b] = score;
+    }
+
+private:
+    // In a union so that making a list doesn't construct 256 null moves first
+    union
+    {
+        BitMove _moves[MAX_MOVES];
+    };
+    int _scores[MAX_MOVES];
+    size_t _size;
+};
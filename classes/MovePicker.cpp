@@ -0,0 +1,111 @@
+#include "MovePicker.h"
+
+MovePicker::MovePicker(const MoveGenerator& moveGenerator, const Position& position, const BitMove& ttMove, const BitMove* killers, const HistoryTable& history)
+    : _moveGenerator(moveGenerator), _position(position), _history(history), _capturesOnly(false), _stage(STAGE_TT_MOVE), _current(0)
+{
+    // Hash and killer moves come from other positions, so only keep them if they are legal here
+    if (_moveGenerator.isLegal(position, ttMove)) _ttMove = ttMove;
+    for (int i = 0; i < 2; i++)
+    {
+        if (!(killers[i] == _ttMove) && !killers[i].isCaptureOrPromotion() && _moveGenerator.isLegal(position, killers[i])) _killers[i] = killers[i];
+    }
+}
+
+MovePicker::MovePicker(const MoveGenerator& moveGenerator, const Position& position, const HistoryTable& history)
+    : _moveGenerator(moveGenerator), _position(position), _history(history), _capturesOnly(true), _stage(STAGE_GENERATE_CAPTURES), _current(0)
+{
+}
+
+BitMove MovePicker::pickBest()
+{
+    size_t best = _current;
+    for (size_t i = _current + 1; i < _moves.size(); i++)
+    {
+        if (_moves.score(i) > _moves.score(best)) best = i;
+    }
+    _moves.swap(_current, best);
+    return _moves[_current++];
+}
+
+bool MovePicker::next(BitMove& move)
+{
+    while (true)
+    {
+        switch (_stage)
+        {
+        case STAGE_TT_MOVE:
+            _stage++;
+            if (!_ttMove.isNull())
+            {
+                move = _ttMove;
+                return true;
+            }
+            break;
+
+        case STAGE_GENERATE_CAPTURES:
+            _moveGenerator.computeLegalInfo(_position, _legalInfo);
+            _moveGenerator.generateCaptures(_position, _legalInfo, _moves);
+            for (size_t i = 0; i < _moves.size(); i++)
+            {
+                const BitMove& move = _moves[i];
+                int score = 0;
+                // Bitboard index % 7 is the piece type from pawn (0) to king (5)
+                if (move.isCapture())
+                {
+                    int victim = move.isEnPassant() ? 0 : _position.pieceOn(move.to) % 7;
+                    score = victim * 8 - _position.pieceOn(move.from) % 7;
+                }
+                // Queening goes ahead of every plain capture, underpromotions behind them all
+                if (move.isPromotion()) score += move.promotionPiece() == Queen ? 64 : -128;
+                _moves.score(i) = score;
+            }
+            _current = 0;
+            _stage++;
+            break;
+
+        case STAGE_CAPTURES:
+            while (_current < _moves.size())
+            {
+                move = pickBest();
+                if (!(move == _ttMove)) return true;
+            }
+            _stage = _capturesOnly ? STAGE_DONE : _stage + 1;
+            break;
+
+        case STAGE_KILLER_1:
+        case STAGE_KILLER_2:
+        {
+            const BitMove& killer = _killers[_stage - STAGE_KILLER_1];
+            _stage++;
+            if (!killer.isNull())
+            {
+                move = killer;
+                return true;
+            }
+            break;
+        }
+
+        case STAGE_GENERATE_QUIETS:
+            _moveGenerator.generateQuiets(_position, _legalInfo, _moves);
+            for (size_t i = 0; i < _moves.size(); i++)
+            {
+                _moves.score(i) = _history[_position.getSideToMove()][_moves[i].from][_moves[i].to];
+            }
+            _current = 0;
+            _stage++;
+            break;
+
+        case STAGE_QUIETS:
+            while (_current < _moves.size())
+            {
+                move = pickBest();
+                if (!(move == _ttMove) && !isKiller(move)) return true;
+            }
+            _stage++;
+            break;
+
+        default:
+            return false;
+        }
+    }
+}
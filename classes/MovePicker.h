@@ -0,0 +1,57 @@
+#pragma once
+
+#include "MoveGenerator.h"
+
+// History scores are kept within +-MAX_HISTORY
+constexpr int MAX_HISTORY = 16384;
+
+// Butterfly history: how often a quiet move from one square to another caused a cutoff, per side
+typedef int HistoryTable[2][64][64];
+
+//
+// Hands out a node's moves best-first, generating them in stages only as they are asked for:
+// the hash move, then captures and promotions by MVV-LVA (most valuable victim, least valuable
+// attacker), then the two killer moves for this ply, then the remaining quiet moves by history. When an early
+// move causes a cutoff, the quiet moves are never generated at all. Within a stage moves are
+// picked by selection, so the rest of the stage is never sorted either.
+//
+class MovePicker
+{
+public:
+    // Every legal move, for the main search
+    MovePicker(const MoveGenerator& moveGenerator, const Position& position, const BitMove& ttMove, const BitMove* killers, const HistoryTable& history);
+    // Captures and promotions only, for quiescence search
+    MovePicker(const MoveGenerator& moveGenerator, const Position& position, const HistoryTable& history);
+
+    // Sets move to the next best move, returns false when there are none left
+    bool next(BitMove& move);
+
+private:
+    enum Stage
+    {
+        STAGE_TT_MOVE,
+        STAGE_GENERATE_CAPTURES,
+        STAGE_CAPTURES,
+        STAGE_KILLER_1,
+        STAGE_KILLER_2,
+        STAGE_GENERATE_QUIETS,
+        STAGE_QUIETS,
+        STAGE_DONE
+    };
+
+    // Moves the best scored move left in the current stage to the front and returns it
+    BitMove pickBest();
+    bool isKiller(const BitMove& move) const { return move == _killers[0] || move == _killers[1]; }
+
+    const MoveGenerator& _moveGenerator;
+    const Position& _position;
+    const HistoryTable& _history;
+    BitMove _ttMove;
+    BitMove _killers[2];
+    bool _capturesOnly;
+    int _stage;
+    MoveGenerator::LegalInfo _legalInfo;
+
+    MoveList _moves;
+    size_t _current;
+};
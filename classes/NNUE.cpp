@@ -0,0 +1,304 @@
+#include "NNUE.h"
+#include "CpuFeatures.h"
+#include <cstring>
+
+namespace NNUE
+{
+
+// Byte offsets of each array in a network file, every one rounded up to a cache line
+static constexpr size_t align64(size_t offset) { return (offset + 63) & ~(size_t)63; }
+
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t TRANSFORMER_BIASES = HEADER_SIZE;
+constexpr size_t TRANSFORMER_WEIGHTS = align64(TRANSFORMER_BIASES + HALF_DIMENSIONS * sizeof(int16_t));
+constexpr size_t HIDDEN_1_BIASES = align64(TRANSFORMER_WEIGHTS + (size_t)FEATURES * HALF_DIMENSIONS * sizeof(int16_t));
+constexpr size_t HIDDEN_1_WEIGHTS = align64(HIDDEN_1_BIASES + HIDDEN_1 * sizeof(int32_t));
+constexpr size_t HIDDEN_2_BIASES = align64(HIDDEN_1_WEIGHTS + HIDDEN_1 * 2 * HALF_DIMENSIONS);
+constexpr size_t HIDDEN_2_WEIGHTS = align64(HIDDEN_2_BIASES + HIDDEN_2 * sizeof(int32_t));
+constexpr size_t OUTPUT_BIAS = align64(HIDDEN_2_WEIGHTS + HIDDEN_2 * HIDDEN_1);
+constexpr size_t OUTPUT_WEIGHTS = align64(OUTPUT_BIAS + sizeof(int32_t));
+constexpr size_t FILE_SIZE = align64(OUTPUT_WEIGHTS + HIDDEN_2);
+
+static const char Magic[8] = { 'N', 'N', 'U', 'E', 'H', 'K', 'P', '1' };
+
+// The layers only ever see multiples of 32 inputs, so every kernel works in whole vectors
+static_assert(HALF_DIMENSIONS % 32 == 0 && HIDDEN_1 % 32 == 0, "layer widths must be multiples of 32");
+
+//
+// Scalar kernels, for CPUs without SSE2. The output neuron is only 32 wide, so it always uses dotScalar.
+//
+#if !defined(CPU_X86)
+static void updateScalar(int16_t* half, const int16_t* weights, const int* removed, int removedCount, const int* added, int addedCount)
+{
+    for (int i = 0; i < removedCount; i++)
+    {
+        const int16_t* column = weights + (size_t)removed[i] * HALF_DIMENSIONS;
+        for (int j = 0; j < HALF_DIMENSIONS; j++) half[j] -= column[j];
+    }
+    for (int i = 0; i < addedCount; i++)
+    {
+        const int16_t* column = weights + (size_t)added[i] * HALF_DIMENSIONS;
+        for (int j = 0; j < HALF_DIMENSIONS; j++) half[j] += column[j];
+    }
+}
+
+static void clipScalar(const int16_t* half, uint8_t* output)
+{
+    for (int i = 0; i < HALF_DIMENSIONS; i++) output[i] = (uint8_t)(half[i] < 0 ? 0 : half[i] > 127 ? 127 : half[i]);
+}
+#endif
+
+static int32_t dotScalar(const uint8_t* input, const int8_t* weights, int count)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < count; i++) sum += input[i] * weights[i];
+    return sum;
+}
+
+#if defined(CPU_X86)
+//
+// SSE2 kernels, which every 64-bit x86 CPU has. SSE2 has no unsigned-by-signed byte multiply, so
+// the dot product widens both sides to 16 bits first.
+//
+static void updateSse2(int16_t* half, const int16_t* weights, const int* removed, int removedCount, const int* added, int addedCount)
+{
+    for (int j = 0; j < HALF_DIMENSIONS; j += 8)
+    {
+        __m128i sum = _mm_load_si128((const __m128i*)(half + j));
+        for (int i = 0; i < removedCount; i++)
+        {
+            sum = _mm_sub_epi16(sum, _mm_loadu_si128((const __m128i*)(weights + (size_t)removed[i] * HALF_DIMENSIONS + j)));
+        }
+        for (int i = 0; i < addedCount; i++)
+        {
+            sum = _mm_add_epi16(sum, _mm_loadu_si128((const __m128i*)(weights + (size_t)added[i] * HALF_DIMENSIONS + j)));
+        }
+        _mm_store_si128((__m128i*)(half + j), sum);
+    }
+}
+
+static void clipSse2(const int16_t* half, uint8_t* output)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < HALF_DIMENSIONS; i += 16)
+    {
+        // Negative sums go to zero first, then packing saturates everything above 127
+        __m128i low = _mm_max_epi16(_mm_load_si128((const __m128i*)(half + i)), zero);
+        __m128i high = _mm_max_epi16(_mm_load_si128((const __m128i*)(half + i + 8)), zero);
+        _mm_store_si128((__m128i*)(output + i), _mm_packs_epi16(low, high));
+    }
+}
+
+static int32_t dotSse2(const uint8_t* input, const int8_t* weights, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (int i = 0; i < count; i += 16)
+    {
+        __m128i in = _mm_load_si128((const __m128i*)(input + i));
+        __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+        // Inputs are 0..127 so zero extend, weights are signed so sign extend
+        __m128i inLow = _mm_unpacklo_epi8(in, zero);
+        __m128i inHigh = _mm_unpackhi_epi8(in, zero);
+        __m128i wLow = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+        __m128i wHigh = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(inLow, wLow));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(inHigh, wHigh));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+//
+// AVX2 kernels, only built for AVX2 themselves and only called once cpuHasAvx2() has found it
+//
+CPU_TARGET_AVX2 static void updateAvx2(int16_t* half, const int16_t* weights, const int* removed, int removedCount, const int* added, int addedCount)
+{
+    for (int j = 0; j < HALF_DIMENSIONS; j += 16)
+    {
+        __m256i sum = _mm256_load_si256((const __m256i*)(half + j));
+        for (int i = 0; i < removedCount; i++)
+        {
+            sum = _mm256_sub_epi16(sum, _mm256_loadu_si256((const __m256i*)(weights + (size_t)removed[i] * HALF_DIMENSIONS + j)));
+        }
+        for (int i = 0; i < addedCount; i++)
+        {
+            sum = _mm256_add_epi16(sum, _mm256_loadu_si256((const __m256i*)(weights + (size_t)added[i] * HALF_DIMENSIONS + j)));
+        }
+        _mm256_store_si256((__m256i*)(half + j), sum);
+    }
+}
+
+CPU_TARGET_AVX2 static void clipAvx2(const int16_t* half, uint8_t* output)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < HALF_DIMENSIONS; i += 32)
+    {
+        __m256i low = _mm256_max_epi16(_mm256_load_si256((const __m256i*)(half + i)), zero);
+        __m256i high = _mm256_max_epi16(_mm256_load_si256((const __m256i*)(half + i + 16)), zero);
+        // Packing works within 128-bit lanes, so put the quarters back in order afterwards
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xD8);
+        _mm256_store_si256((__m256i*)(output + i), packed);
+    }
+}
+
+CPU_TARGET_AVX2 static int32_t dotAvx2(const uint8_t* input, const int8_t* weights, int count)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < count; i += 32)
+    {
+        // Pairs of 127 * 127 products fit in 16 bits without saturating
+        __m256i products = _mm256_maddubs_epi16(_mm256_load_si256((const __m256i*)(input + i)),
+                                                _mm256_loadu_si256((const __m256i*)(weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+// Picked once, when the program starts
+#if defined(CPU_X86)
+static const bool UseAvx2 = cpuHasAvx2();
+#endif
+
+static inline void updateHalf(int16_t* half, const int16_t* weights, const int* removed, int removedCount, const int* added, int addedCount)
+{
+#if defined(CPU_X86)
+    if (UseAvx2) updateAvx2(half, weights, removed, removedCount, added, addedCount);
+    else updateSse2(half, weights, removed, removedCount, added, addedCount);
+#else
+    updateScalar(half, weights, removed, removedCount, added, addedCount);
+#endif
+}
+
+static inline void clipHalf(const int16_t* half, uint8_t* output)
+{
+#if defined(CPU_X86)
+    if (UseAvx2) clipAvx2(half, output);
+    else clipSse2(half, output);
+#else
+    clipScalar(half, output);
+#endif
+}
+
+static inline int32_t dot(const uint8_t* input, const int8_t* weights, int count)
+{
+#if defined(CPU_X86)
+    return UseAvx2 ? dotAvx2(input, weights, count) : dotSse2(input, weights, count);
+#else
+    return dotScalar(input, weights, count);
+#endif
+}
+
+// A dense layer of int8 weights, one row per output, followed by a clipped ReLU
+static inline void hiddenLayer(const uint8_t* input, int inputCount, const int8_t* weights, const int32_t* biases,
+                               uint8_t* output, int outputCount)
+{
+    for (int i = 0; i < outputCount; i++)
+    {
+        int32_t sum = (biases[i] + dot(input, weights + (size_t)i * inputCount, inputCount)) >> WEIGHT_SHIFT;
+        output[i] = (uint8_t)(sum < 0 ? 0 : sum > 127 ? 127 : sum);
+    }
+}
+
+Network::Network()
+    : _data(nullptr),
+      _transformerBiases(nullptr), _transformerWeights(nullptr), _hidden1Biases(nullptr), _hidden1Weights(nullptr),
+      _hidden2Biases(nullptr), _hidden2Weights(nullptr), _outputBias(nullptr), _outputWeights(nullptr)
+{
+}
+
+void Network::unmap()
+{
+    _file.unmap();
+    _data = nullptr;
+}
+
+void Network::unload()
+{
+    unmap();
+    _error.clear();
+}
+
+bool Network::load(const std::string& path)
+{
+    unload();
+
+    if (!_file.map(path))
+    {
+        _error = _file.getError();
+        return false;
+    }
+    if (_file.getSize() != FILE_SIZE)
+    {
+        _error = path + " is not a HalfKP 256x2-32-32 network (wrong size)";
+        unmap();
+        return false;
+    }
+    _data = _file.getData();
+
+    uint32_t dimensions[4];
+    memcpy(dimensions, _data + sizeof(Magic), sizeof(dimensions));
+    if (memcmp(_data, Magic, sizeof(Magic)) != 0 || dimensions[0] != FEATURES || dimensions[1] != HALF_DIMENSIONS ||
+        dimensions[2] != HIDDEN_1 || dimensions[3] != HIDDEN_2)
+    {
+        _error = path + " is not a HalfKP 256x2-32-32 network (bad header)";
+        unmap();
+        return false;
+    }
+
+    // Mappings start on a page boundary, so every array is cache line aligned
+    _transformerBiases = (const int16_t*)(_data + TRANSFORMER_BIASES);
+    _transformerWeights = (const int16_t*)(_data + TRANSFORMER_WEIGHTS);
+    _hidden1Biases = (const int32_t*)(_data + HIDDEN_1_BIASES);
+    _hidden1Weights = (const int8_t*)(_data + HIDDEN_1_WEIGHTS);
+    _hidden2Biases = (const int32_t*)(_data + HIDDEN_2_BIASES);
+    _hidden2Weights = (const int8_t*)(_data + HIDDEN_2_WEIGHTS);
+    _outputBias = (const int32_t*)(_data + OUTPUT_BIAS);
+    _outputWeights = (const int8_t*)(_data + OUTPUT_WEIGHTS);
+    return true;
+}
+
+void Network::refresh(Accumulator& accumulator, int perspective, const int* features, int count) const
+{
+    int16_t* half = accumulator.values[perspective];
+    memcpy(half, _transformerBiases, sizeof(accumulator.values[perspective]));
+    updateHalf(half, _transformerWeights, nullptr, 0, features, count);
+}
+
+void Network::update(Accumulator& accumulator, int perspective, const int* removed, int removedCount,
+                     const int* added, int addedCount) const
+{
+    updateHalf(accumulator.values[perspective], _transformerWeights, removed, removedCount, added, addedCount);
+}
+
+int Network::evaluate(const Accumulator& accumulator, int sideToMove) const
+{
+    alignas(64) uint8_t input[2 * HALF_DIMENSIONS];
+    alignas(64) uint8_t hidden1[HIDDEN_1];
+    alignas(64) uint8_t hidden2[HIDDEN_2];
+
+    // The side to move's half always comes first
+    clipHalf(accumulator.values[sideToMove], input);
+    clipHalf(accumulator.values[sideToMove ^ 1], input + HALF_DIMENSIONS);
+    hiddenLayer(input, 2 * HALF_DIMENSIONS, _hidden1Weights, _hidden1Biases, hidden1, HIDDEN_1);
+    hiddenLayer(hidden1, HIDDEN_1, _hidden2Weights, _hidden2Biases, hidden2, HIDDEN_2);
+    int32_t output = _outputBias[0] + dotScalar(hidden2, _outputWeights, HIDDEN_2);
+    return output / OUTPUT_SCALE;
+}
+
+const char* Network::backend()
+{
+#if defined(CPU_X86)
+    return UseAvx2 ? "AVX2" : "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+}
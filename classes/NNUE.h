@@ -0,0 +1,107 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//
+// Efficiently updatable neural network evaluation (NNUE) with HalfKP inputs.
+//
+// Each side sees the board relative to its own king: an input feature is a (king square, piece,
+// square) triple for every piece other than the two kings, with the board flipped for black so
+// both halves look the same. A position has at most 30 active features per side out of 40960, so
+// the first layer is an accumulator of 256 sums per side that Position keeps up to date by adding
+// and subtracting weight columns as pieces move. Only a king move starts that side's half again.
+//
+// Evaluating is then cheap: the side to move's half and the other side's half are clipped to
+// 0..127 and run through two small int8 layers of 32 neurons and an output neuron, with AVX2 or
+// SSE2 when the CPU has them.
+//
+// Networks are a flat little-endian file, mapped into memory rather than read so loading is
+// instant and every process using the same file shares one copy:
+//
+//     64 byte header: "NNUEHKP1", then uint32 features, half dimensions, hidden 1 and hidden 2
+//     int16 transformer biases[256]
+//     int16 transformer weights[40960][256]
+//     int32 hidden 1 biases[32]
+//     int8  hidden 1 weights[32][512]
+//     int32 hidden 2 biases[32]
+//     int8  hidden 2 weights[32][32]
+//     int32 output bias
+//     int8  output weights[32]
+//
+// with every array starting on a 64 byte boundary (padded with zeros after the one before).
+//
+namespace NNUE
+{
+    constexpr int PIECE_KINDS = 10;    // pawn to queen, ours and theirs
+    constexpr int FEATURES = 64 * PIECE_KINDS * 64;
+    constexpr int HALF_DIMENSIONS = 256;
+    constexpr int HIDDEN_1 = 32;
+    constexpr int HIDDEN_2 = 32;
+    // At most one feature per piece other than the kings
+    constexpr int MAX_ACTIVE_FEATURES = 30;
+
+    // Hidden layer sums are divided by 2^WEIGHT_SHIFT before clipping, and the output by
+    // OUTPUT_SCALE to give centipawns
+    constexpr int WEIGHT_SHIFT = 6;
+    constexpr int OUTPUT_SCALE = 16;
+
+    // First layer sums for white's half and black's half
+    struct alignas(64) Accumulator
+    {
+        int16_t values[2][HALF_DIMENSIONS];
+    };
+
+    // Input feature of a piece from one side's point of view. piece is a bitboard index
+    // (WHITE_PAWNS .. BLACK_QUEENS), and kingSquare is the square of that side's own king.
+    inline int featureIndex(int perspective, int kingSquare, int piece, int square)
+    {
+        int flip = perspective == 0 ? 0 : 56;
+        int kind = (piece % 7) * 2 + (piece / 7 != perspective);
+        return (((kingSquare ^ flip) * PIECE_KINDS + kind) << 6) + (square ^ flip);
+    }
+
+    class Network
+    {
+    public:
+        Network();
+        Network(const Network&) = delete;
+        Network& operator=(const Network&) = delete;
+
+        // Maps a network file, replacing any network already loaded. Returns false, with the
+        // reason in getError(), if the file can't be mapped or isn't a network of this shape.
+        bool load(const std::string& path);
+        void unload();
+        bool isLoaded() const { return _data != nullptr; }
+        const std::string& getError() const { return _error; }
+
+        // Sets one side's half of the accumulator to the biases plus the given features
+        void refresh(Accumulator& accumulator, int perspective, const int* features, int count) const;
+        // Subtracts the removed features from one side's half and adds the added ones
+        void update(Accumulator& accumulator, int perspective, const int* removed, int removedCount,
+                    const int* added, int addedCount) const;
+        // Score in centipawns from the side to move's point of view
+        int evaluate(const Accumulator& accumulator, int sideToMove) const;
+
+        // The instruction set the layers run on, for logging
+        static const char* backend();
+
+    private:
+        void unmap();
+
+        MappedFile _file;
+        const uint8_t* _data;
+        std::string _error;
+
+        const int16_t* _transformerBiases;
+        const int16_t* _transformerWeights;
+        const int32_t* _hidden1Biases;
+        const int8_t* _hidden1Weights;
+        const int32_t* _hidden2Biases;
+        const int8_t* _hidden2Weights;
+        const int32_t* _outputBias;
+        const int8_t* _outputWeights;
+    };
+}
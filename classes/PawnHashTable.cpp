@@ -0,0 +1,145 @@
+#include "PawnHashTable.h"
+#include "Evaluation.h"
+
+// Everything below looks at the board from white's side; for black both sides' pawns are flipped first
+constexpr uint64_t FileA = 0x0101010101010101ULL;
+constexpr uint64_t FileH = 0x8080808080808080ULL;
+
+// Middlegame and endgame penalties per pawn
+constexpr int DoubledPenalty[2] = { 10, 20 };
+constexpr int IsolatedPenalty[2] = { 10, 15 };
+constexpr int BackwardPenalty[2] = { 8, 10 };
+// Passed pawn bonus by rank, on top of the endgame piece-square table's bonus for advancing
+constexpr int PassedMiddlegame[8] = { 0, 0, 5, 10, 20, 35, 60, 0 };
+constexpr int PassedEndgame[8] = { 0, 5, 10, 20, 40, 70, 110, 0 };
+// Shelter bonus per pawn one and two squares in front of the king, and penalty per open file beside it
+constexpr int ShieldNear = 10;
+constexpr int ShieldFar = 5;
+constexpr int OpenFileNearKing = 15;
+
+static inline uint64_t northFill(uint64_t b) { b |= b << 8; b |= b << 16; return b | (b << 32); }
+static inline uint64_t southFill(uint64_t b) { b |= b >> 8; b |= b >> 16; return b | (b >> 32); }
+static inline uint64_t eastOne(uint64_t b) { return (b & ~FileH) << 1; }
+static inline uint64_t westOne(uint64_t b) { return (b & ~FileA) >> 1; }
+static inline int countBits(uint64_t b) { return Bitboard(b).countBits(); }
+
+// Mirrors the board top to bottom, so black's pawns can be scored as if they were white's
+static inline uint64_t flipVertical(uint64_t b)
+{
+    b = ((b >> 8) & 0x00FF00FF00FF00FFULL) | ((b & 0x00FF00FF00FF00FFULL) << 8);
+    b = ((b >> 16) & 0x0000FFFF0000FFFFULL) | ((b & 0x0000FFFF0000FFFFULL) << 16);
+    return (b >> 32) | (b << 32);
+}
+
+static inline int kingSquare(const Position& position, int color)
+{
+    int square = 0;
+    Bitboard(position.getBitboard(color == WHITE ? WHITE_KING : BLACK_KING)).forEachBit([&](int s) { square = s; });
+    return square;
+}
+
+//
+// Scores one side's pawn structure. A pawn is doubled if another of ours is behind it on its file,
+// isolated if no pawn of ours is on a file beside it, backward if its stop square is attacked by
+// an enemy pawn and no pawn of ours can ever defend it, and passed if no enemy pawn is ahead of it
+// on its own or a neighbouring file and none of ours is ahead of it either.
+//
+static void evaluateSide(uint64_t ours, uint64_t theirs, int& middlegame, int& endgame)
+{
+    uint64_t doubled = ours & northFill(ours << 8);
+    uint64_t neighbourFiles = northFill(southFill(eastOne(ours) | westOne(ours)));
+    uint64_t isolated = ours & ~neighbourFiles;
+
+    uint64_t ourAttackSpans = northFill(eastOne(ours << 8) | westOne(ours << 8));
+    uint64_t theirAttacks = eastOne(theirs >> 8) | westOne(theirs >> 8);
+    uint64_t backward = ((ours << 8) & theirAttacks & ~ourAttackSpans) >> 8;
+
+    uint64_t theirFrontSpans = southFill(theirs >> 8);
+    uint64_t passed = ours & ~(theirFrontSpans | eastOne(theirFrontSpans) | westOne(theirFrontSpans)) & ~southFill(ours >> 8);
+
+    int doubledCount = countBits(doubled);
+    int isolatedCount = countBits(isolated);
+    int backwardCount = countBits(backward & ~isolated);
+    middlegame = -doubledCount * DoubledPenalty[0] - isolatedCount * IsolatedPenalty[0] - backwardCount * BackwardPenalty[0];
+    endgame = -doubledCount * DoubledPenalty[1] - isolatedCount * IsolatedPenalty[1] - backwardCount * BackwardPenalty[1];
+    Bitboard(passed).forEachBit([&](int square)
+    {
+        middlegame += PassedMiddlegame[square >> 3];
+        endgame += PassedEndgame[square >> 3];
+    });
+}
+
+// Pawns on the king's file and the files beside it, one and two squares in front of it
+static int shelter(uint64_t ours, int kingSquare)
+{
+    uint64_t king = 1ULL << kingSquare;
+    uint64_t files = king | eastOne(king) | westOne(king);
+    int score = countBits(ours & (files << 8)) * ShieldNear + countBits(ours & (files << 16)) * ShieldFar;
+    Bitboard(files).forEachBit([&](int square)
+    {
+        if (!(northFill(1ULL << square) & ours)) score -= OpenFileNearKing;
+    });
+    return score;
+}
+
+PawnHashTable::PawnHashTable()
+    : _entries(ENTRIES), _probes(0), _hits(0)
+{
+    clear();
+}
+
+void PawnHashTable::clear()
+{
+    // An all zero entry is the right answer for the position with no pawns, whose key is 0, so
+    // only the shelter squares need to say there is nothing cached
+    for (Entry& entry : _entries)
+    {
+        entry = Entry();
+        entry.shelterSquare[WHITE] = entry.shelterSquare[BLACK] = -1;
+    }
+    resetStats();
+}
+
+PawnHashTable::Entry& PawnHashTable::probe(const Position& position)
+{
+    uint64_t key = position.getPawnKey();
+    Entry& entry = _entries[key & (ENTRIES - 1)];
+    _probes++;
+    if (entry.key == key)
+    {
+        _hits++;
+        return entry;
+    }
+
+    // Each side is scored in its own frame, with the other side's pawns in that frame too
+    uint64_t white = position.getBitboard(WHITE_PAWNS);
+    uint64_t black = position.getBitboard(BLACK_PAWNS);
+    int whiteMiddlegame, whiteEndgame, blackMiddlegame, blackEndgame;
+    evaluateSide(white, black, whiteMiddlegame, whiteEndgame);
+    evaluateSide(flipVertical(black), flipVertical(white), blackMiddlegame, blackEndgame);
+
+    entry.key = key;
+    entry.middlegame = (int16_t)(whiteMiddlegame - blackMiddlegame);
+    entry.endgame = (int16_t)(whiteEndgame - blackEndgame);
+    entry.shelterSquare[WHITE] = entry.shelterSquare[BLACK] = -1;
+    return entry;
+}
+
+int PawnHashTable::evaluate(const Position& position)
+{
+    Entry& entry = probe(position);
+
+    for (int color = WHITE; color <= BLACK; color++)
+    {
+        int square = kingSquare(position, color);
+        if (entry.shelterSquare[color] != square)
+        {
+            uint64_t pawns = position.getBitboard(color == WHITE ? WHITE_PAWNS : BLACK_PAWNS);
+            entry.shelter[color] = (int16_t)(color == WHITE ? shelter(pawns, square) : shelter(flipVertical(pawns), square ^ 56));
+            entry.shelterSquare[color] = (int8_t)square;
+        }
+    }
+
+    int middlegame = entry.middlegame + entry.shelter[WHITE] - entry.shelter[BLACK];
+    return Evaluation::taper(middlegame, entry.endgame, position.getPhase());
+}
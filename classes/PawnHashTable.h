@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Position.h"
+#include <vector>
+
+//
+// Pawn structure evaluation with a cache of its own. Passed, isolated, doubled and backward pawns
+// are found with set-wise bitboard operations, but they only change when a pawn moves or is
+// taken, so the result is kept in a small table keyed by Position's pawn-only Zobrist key and
+// nearly every evaluation finds it there. King shelter depends on the king square as well, so
+// each entry keeps the last shelter worked out for each king alongside the square it was for.
+//
+// Each search thread has its own table, so it needs no locking.
+//
+class PawnHashTable
+{
+public:
+    static constexpr size_t ENTRIES = 65536;
+
+    PawnHashTable();
+
+    // Tapered pawn structure and king shelter score in centipawns from white's point of view
+    int evaluate(const Position& position);
+
+    void clear();
+    // Lookups and how many of them found their pawn structure already in the table
+    uint64_t getProbes() const { return _probes; }
+    uint64_t getHits() const { return _hits; }
+    void resetStats() { _probes = _hits = 0; }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        int16_t middlegame;
+        int16_t endgame;
+        // King shelter (middlegame only) and the king square it was worked out for
+        int16_t shelter[2];
+        int8_t shelterSquare[2];
+    };
+
+    Entry& probe(const Position& position);
+
+    std::vector<Entry> _entries;
+    uint64_t _probes;
+    uint64_t _hits;
+};
@@ -0,0 +1,460 @@
+#include "Position.h"
+#include "MoveGenerator.h"
+#include "Evaluation.h"
+#include <sstream>
+
+// Castling rights that survive a move touching each square (king and rook home squares)
+static inline int castlingMask(int square)
+{
+    switch (square)
+    {
+        case 0:  return ~WHITE_QUEENSIDE & 0xF;
+        case 4:  return ~(WHITE_KINGSIDE | WHITE_QUEENSIDE) & 0xF;
+        case 7:  return ~WHITE_KINGSIDE & 0xF;
+        case 56: return ~BLACK_QUEENSIDE & 0xF;
+        case 60: return ~(BLACK_KINGSIDE | BLACK_QUEENSIDE) & 0xF;
+        case 63: return ~BLACK_KINGSIDE & 0xF;
+        default: return 0xF;
+    }
+}
+
+//
+// Random keys for Zobrist hashing, generated at compile time with a fixed seed so that keys
+// are the same on every run and every machine
+//
+struct ZobristKeys
+{
+    uint64_t pieceSquare[14][64];
+    uint64_t castling[16];
+    uint64_t enPassantFile[8];
+    uint64_t sideToMove;
+
+    constexpr ZobristKeys() : pieceSquare(), castling(), enPassantFile(), sideToMove(0)
+    {
+        // xorshift64*
+        uint64_t seed = 0x9E3779B97F4A7C15ULL;
+        auto next = [&seed]()
+        {
+            seed ^= seed >> 12;
+            seed ^= seed << 25;
+            seed ^= seed >> 27;
+            return seed * 0x2545F4914F6CDD1DULL;
+        };
+
+        for (int piece = 0; piece < 14; piece++)
+        {
+            // the color occupancy bitboards aren't pieces and never change the key
+            bool occupancy = piece == WHITE_ALL || piece == BLACK_ALL;
+            for (int square = 0; square < 64; square++) pieceSquare[piece][square] = occupancy ? 0 : next();
+        }
+        // each castling right gets a key, combinations are the XOR of their rights
+        uint64_t rights[4] = { next(), next(), next(), next() };
+        for (int i = 0; i < 16; i++)
+        {
+            for (int bit = 0; bit < 4; bit++) if (i & (1 << bit)) castling[i] ^= rights[bit];
+        }
+        for (int file = 0; file < 8; file++) enPassantFile[file] = next();
+        sideToMove = next();
+    }
+};
+
+static constexpr ZobristKeys Zobrist;
+
+Position::Position()
+    : _network(nullptr)
+{
+    clear();
+    _history.reserve(256);
+}
+
+void Position::clear()
+{
+    for (int i = 0; i < 14; i++) _bitboards[i] = 0ULL;
+    for (int i = 0; i < 64; i++) _mailbox[i] = EMPTY_SQUARES;
+    _sideToMove = WHITE;
+    _castlingRights = 0;
+    _enPassantSquare = NO_SQUARE;
+    _halfmoveClock = 0;
+    _fullmoveNumber = 1;
+    _zobristKey = 0;
+    _pawnKey = 0;
+    _materialKey = 0;
+    _attacks[WHITE] = _attacks[BLACK] = 0ULL;
+    _checkers = 0ULL;
+    _middlegameScore = _endgameScore = _phase = 0;
+    _history.clear();
+    _accumulatorHistory.clear();
+}
+
+bool Position::setFEN(const std::string& fen)
+{
+    clear();
+
+    std::istringstream stream(fen);
+    std::string placement, side, castling, enPassant;
+    stream >> placement >> side >> castling >> enPassant >> _halfmoveClock >> _fullmoveNumber;
+
+    // Piece placement, starting from a8
+    int x = 0;
+    int y = 7;
+    for (char c : placement)
+    {
+        if (c == '/')
+        {
+            y--;
+            x = 0;
+            continue;
+        }
+        if (c >= '1' && c <= '8')
+        {
+            x += c - '0';
+            continue;
+        }
+
+        int index;
+        switch (c)
+        {
+            case 'P': index = WHITE_PAWNS; break;
+            case 'N': index = WHITE_KNIGHTS; break;
+            case 'B': index = WHITE_BISHOPS; break;
+            case 'R': index = WHITE_ROOKS; break;
+            case 'Q': index = WHITE_QUEENS; break;
+            case 'K': index = WHITE_KING; break;
+            case 'p': index = BLACK_PAWNS; break;
+            case 'n': index = BLACK_KNIGHTS; break;
+            case 'b': index = BLACK_BISHOPS; break;
+            case 'r': index = BLACK_ROOKS; break;
+            case 'q': index = BLACK_QUEENS; break;
+            case 'k': index = BLACK_KING; break;
+            default: return false;
+        }
+        if (x > 7 || y < 0) return false;
+
+        int square = y * 8 + x;
+        _bitboards[index] |= 1ULL << square;
+        _bitboards[index < WHITE_ALL ? WHITE_ALL : BLACK_ALL] |= 1ULL << square;
+        _mailbox[square] = index;
+        _materialKey += 1ULL << (index * 4);
+        x++;
+    }
+
+    _sideToMove = side == "b" ? BLACK : WHITE;
+
+    for (char c : castling)
+    {
+        if (c == 'K') _castlingRights |= WHITE_KINGSIDE;
+        if (c == 'Q') _castlingRights |= WHITE_QUEENSIDE;
+        if (c == 'k') _castlingRights |= BLACK_KINGSIDE;
+        if (c == 'q') _castlingRights |= BLACK_QUEENSIDE;
+    }
+
+    if (enPassant.length() == 2 && enPassant[0] >= 'a' && enPassant[0] <= 'h' && enPassant[1] >= '1' && enPassant[1] <= '8')
+    {
+        _enPassantSquare = (enPassant[1] - '1') * 8 + (enPassant[0] - 'a');
+    }
+
+    if (_fullmoveNumber < 1) _fullmoveNumber = 1;
+    _zobristKey = computeZobristKey();
+    _pawnKey = computePawnKey();
+    computeEvaluation(_middlegameScore, _endgameScore, _phase);
+    if (_network) computeAccumulator(_accumulator);
+    updateAttacks();
+    return true;
+}
+
+uint64_t Position::computeZobristKey() const
+{
+    uint64_t key = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        if (_mailbox[square] != EMPTY_SQUARES) key ^= Zobrist.pieceSquare[_mailbox[square]][square];
+    }
+    key ^= Zobrist.castling[_castlingRights];
+    if (_enPassantSquare != NO_SQUARE) key ^= Zobrist.enPassantFile[_enPassantSquare % 8];
+    if (_sideToMove == BLACK) key ^= Zobrist.sideToMove;
+    return key;
+}
+
+uint64_t Position::computePawnKey() const
+{
+    uint64_t key = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        int piece = _mailbox[square];
+        if (piece == WHITE_PAWNS || piece == BLACK_PAWNS) key ^= Zobrist.pieceSquare[piece][square];
+    }
+    return key;
+}
+
+void Position::computeEvaluation(int& middlegame, int& endgame, int& phase) const
+{
+    middlegame = endgame = phase = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        int piece = _mailbox[square];
+        if (piece == EMPTY_SQUARES) continue;
+        middlegame += Evaluation::PieceSquare.middlegame[piece][square];
+        endgame += Evaluation::PieceSquare.endgame[piece][square];
+        phase += Evaluation::PieceSquare.phase[piece];
+    }
+}
+
+int Position::evaluate() const
+{
+    if (_network)
+    {
+        int score = _network->evaluate(_accumulator, _sideToMove);
+        return _sideToMove == WHITE ? score : -score;
+    }
+    return Evaluation::taper(_middlegameScore, _endgameScore, _phase);
+}
+
+void Position::setNetwork(const NNUE::Network* network)
+{
+    _network = network && network->isLoaded() ? network : nullptr;
+    _accumulatorHistory.clear();
+    if (_network)
+    {
+        _accumulatorHistory.reserve(256);
+        computeAccumulator(_accumulator);
+    }
+}
+
+// HalfKP features of every piece but the kings, from one side's point of view
+int Position::activeFeatures(int perspective, int* features) const
+{
+    int kingSquare = 0;
+    Bitboard(_bitboards[perspective == WHITE ? WHITE_KING : BLACK_KING]).forEachBit([&](int square) { kingSquare = square; });
+
+    int count = 0;
+    for (int piece = WHITE_PAWNS; piece <= BLACK_QUEENS; piece++)
+    {
+        if (piece == WHITE_KING || piece == WHITE_ALL) continue;
+        _bitboards[piece].forEachBit([&](int square)
+        {
+            if (count < NNUE::MAX_ACTIVE_FEATURES) features[count++] = NNUE::featureIndex(perspective, kingSquare, piece, square);
+        });
+    }
+    return count;
+}
+
+void Position::computeAccumulator(NNUE::Accumulator& accumulator) const
+{
+    int features[NNUE::MAX_ACTIVE_FEATURES];
+    for (int perspective = WHITE; perspective <= BLACK; perspective++)
+    {
+        int count = activeFeatures(perspective, features);
+        _network->refresh(accumulator, perspective, features, count);
+    }
+}
+
+bool Position::isRepetition() const
+{
+    // Only positions with the same side to move since the last irreversible move can repeat
+    int count = (int)_history.size();
+    for (int i = 4; i <= _halfmoveClock && i <= count; i += 2)
+    {
+        if (_history[count - i].zobristKey == _zobristKey) return true;
+    }
+    return false;
+}
+
+std::string Position::stateString() const
+{
+    const char* notation = "PNBRQK0pnbrqk00";
+    std::string s(64, '0');
+    for (int i = 0; i < 64; i++) s[i] = notation[_mailbox[i]];
+    return s;
+}
+
+// Rook from and to squares for a castling move, from the king's destination square
+static inline void castlingRookSquares(int kingTo, int& rookFrom, int& rookTo)
+{
+    bool kingside = (kingTo & 7) == 6;
+    rookFrom = kingside ? kingTo + 1 : kingTo - 2;
+    rookTo = kingside ? kingTo - 1 : kingTo + 1;
+}
+
+//
+// Moves a piece between squares, keeping the bitboards, mailbox, Zobrist keys and evaluation in step
+//
+inline void Position::movePiece(int piece, int from, int to)
+{
+    uint64_t fromTo = (1ULL << from) | (1ULL << to);
+    _bitboards[piece] ^= fromTo;
+    _bitboards[piece < WHITE_ALL ? WHITE_ALL : BLACK_ALL] ^= fromTo;
+    _zobristKey ^= Zobrist.pieceSquare[piece][from] ^ Zobrist.pieceSquare[piece][to];
+    if (piece == WHITE_PAWNS || piece == BLACK_PAWNS) _pawnKey ^= Zobrist.pieceSquare[piece][from] ^ Zobrist.pieceSquare[piece][to];
+    _middlegameScore += Evaluation::PieceSquare.middlegame[piece][to] - Evaluation::PieceSquare.middlegame[piece][from];
+    _endgameScore += Evaluation::PieceSquare.endgame[piece][to] - Evaluation::PieceSquare.endgame[piece][from];
+    _mailbox[to] = piece;
+    _mailbox[from] = EMPTY_SQUARES;
+}
+
+// Adds a piece to an empty square, or takes it off again when called a second time
+inline void Position::togglePiece(int piece, int square)
+{
+    _bitboards[piece] ^= 1ULL << square;
+    _bitboards[piece < WHITE_ALL ? WHITE_ALL : BLACK_ALL] ^= 1ULL << square;
+    _zobristKey ^= Zobrist.pieceSquare[piece][square];
+    if (piece == WHITE_PAWNS || piece == BLACK_PAWNS) _pawnKey ^= Zobrist.pieceSquare[piece][square];
+    int sign = _mailbox[square] == EMPTY_SQUARES ? 1 : -1;
+    uint64_t count = 1ULL << (piece * 4);
+    _materialKey = sign > 0 ? _materialKey + count : _materialKey - count;
+    _middlegameScore += sign * Evaluation::PieceSquare.middlegame[piece][square];
+    _endgameScore += sign * Evaluation::PieceSquare.endgame[piece][square];
+    _phase += sign * Evaluation::PieceSquare.phase[piece];
+    _mailbox[square] = sign > 0 ? piece : EMPTY_SQUARES;
+}
+
+// The attack tables live with the move generator, so it does the work
+void Position::updateAttacks()
+{
+    MoveGenerator::computeAttacks(*this, _attacks, _checkers);
+}
+
+//
+// Makes a move, updating the bitboards and the Zobrist key with XOR masks for what changed
+//
+void Position::makeMove(const BitMove& move)
+{
+    int from = move.from;
+    int to = move.to;
+    int piece = _mailbox[from];
+    // En passant takes the pawn beside the destination square instead of one on it
+    int captureSquare = move.isEnPassant() ? (_sideToMove == WHITE ? to - 8 : to + 8) : to;
+    int captured = _mailbox[captureSquare];
+
+    _history.push_back({ _zobristKey, (uint8_t)captured, (uint8_t)_castlingRights, (int8_t)_enPassantSquare, (uint16_t)_halfmoveClock,
+                         { _attacks[WHITE], _attacks[BLACK] }, _checkers });
+    if (_network) _accumulatorHistory.push_back(_accumulator);
+
+    if (captured != EMPTY_SQUARES) togglePiece(captured, captureSquare);
+
+    if (move.isPromotion())
+    {
+        togglePiece(piece, from);
+        togglePiece(piece + move.promotionPiece() - Pawn, to);
+    }
+    else
+    {
+        movePiece(piece, from, to);
+    }
+
+    if (move.isCastle())
+    {
+        int rookFrom, rookTo;
+        castlingRookSquares(to, rookFrom, rookTo);
+        movePiece(_mailbox[rookFrom], rookFrom, rookTo);
+    }
+
+    bool pawnMove = piece == WHITE_PAWNS || piece == BLACK_PAWNS;
+    if (_enPassantSquare != NO_SQUARE) _zobristKey ^= Zobrist.enPassantFile[_enPassantSquare % 8];
+    _enPassantSquare = move.flags == MOVE_DOUBLE_PUSH ? (from + to) / 2 : NO_SQUARE;
+    if (_enPassantSquare != NO_SQUARE) _zobristKey ^= Zobrist.enPassantFile[_enPassantSquare % 8];
+
+    _zobristKey ^= Zobrist.castling[_castlingRights];
+    _castlingRights &= castlingMask(from) & castlingMask(to);
+    _zobristKey ^= Zobrist.castling[_castlingRights];
+
+    _halfmoveClock = (pawnMove || captured != EMPTY_SQUARES) ? 0 : _halfmoveClock + 1;
+    if (_sideToMove == BLACK) _fullmoveNumber++;
+    _sideToMove ^= 1;
+    _zobristKey ^= Zobrist.sideToMove;
+    if (_network) updateAccumulator(move, piece, captured, captureSquare);
+    updateAttacks();
+}
+
+//
+// Brings the network's accumulators up to date after makeMove has moved the pieces: at most two
+// features leave and two arrive for each side. A king move changes every feature of its own side,
+// so that side's half is built again from the board instead.
+//
+void Position::updateAccumulator(const BitMove& move, int piece, int captured, int captureSquare)
+{
+    int movedPiece = move.isPromotion() ? _mailbox[move.to] : piece;
+    int rookFrom = NO_SQUARE, rookTo = NO_SQUARE;
+    if (move.isCastle()) castlingRookSquares(move.to, rookFrom, rookTo);
+
+    for (int perspective = WHITE; perspective <= BLACK; perspective++)
+    {
+        int king = perspective == WHITE ? WHITE_KING : BLACK_KING;
+        int features[NNUE::MAX_ACTIVE_FEATURES];
+        if (piece == king)
+        {
+            int count = activeFeatures(perspective, features);
+            _network->refresh(_accumulator, perspective, features, count);
+            continue;
+        }
+
+        int kingSquare = 0;
+        Bitboard(_bitboards[king]).forEachBit([&](int square) { kingSquare = square; });
+        int removed[2], added[2];
+        int removedCount = 0, addedCount = 0;
+        // The other side's king isn't a feature, but the rook it castles with is
+        if (piece != WHITE_KING && piece != BLACK_KING)
+        {
+            removed[removedCount++] = NNUE::featureIndex(perspective, kingSquare, piece, move.from);
+            added[addedCount++] = NNUE::featureIndex(perspective, kingSquare, movedPiece, move.to);
+        }
+        if (captured != EMPTY_SQUARES) removed[removedCount++] = NNUE::featureIndex(perspective, kingSquare, captured, captureSquare);
+        if (rookFrom != NO_SQUARE)
+        {
+            int rook = _mailbox[rookTo];
+            removed[removedCount++] = NNUE::featureIndex(perspective, kingSquare, rook, rookFrom);
+            added[addedCount++] = NNUE::featureIndex(perspective, kingSquare, rook, rookTo);
+        }
+        _network->update(_accumulator, perspective, removed, removedCount, added, addedCount);
+    }
+}
+
+//
+// Takes back the last move made with makeMove
+//
+void Position::unmakeMove(const BitMove& move)
+{
+    const UndoInfo& undo = _history.back();
+    _sideToMove ^= 1;
+    if (_sideToMove == BLACK) _fullmoveNumber--;
+
+    int from = move.from;
+    int to = move.to;
+
+    if (move.isCastle())
+    {
+        int rookFrom, rookTo;
+        castlingRookSquares(to, rookFrom, rookTo);
+        movePiece(_mailbox[rookTo], rookTo, rookFrom);
+    }
+
+    if (move.isPromotion())
+    {
+        togglePiece(_mailbox[to], to);
+        togglePiece(_sideToMove == WHITE ? WHITE_PAWNS : BLACK_PAWNS, from);
+    }
+    else
+    {
+        movePiece(_mailbox[to], to, from);
+    }
+
+    if (undo.captured != EMPTY_SQUARES)
+    {
+        int captureSquare = move.isEnPassant() ? (_sideToMove == WHITE ? to - 8 : to + 8) : to;
+        togglePiece(undo.captured, captureSquare);
+    }
+
+    // The key was saved, so the XORs made above don't matter
+    _castlingRights = undo.castlingRights;
+    _enPassantSquare = undo.enPassantSquare;
+    _halfmoveClock = undo.halfmoveClock;
+    _zobristKey = undo.zobristKey;
+    _attacks[WHITE] = undo.attacks[WHITE];
+    _attacks[BLACK] = undo.attacks[BLACK];
+    _checkers = undo.checkers;
+    _history.pop_back();
+    if (_network)
+    {
+        _accumulator = _accumulatorHistory.back();
+        _accumulatorHistory.pop_back();
+    }
+}
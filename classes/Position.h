@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Bitboard.h"
+#include "NNUE.h"
+#include <string>
+#include <vector>
+
+#define WHITE 0
+#define BLACK 1
+
+enum AllBitboards
+{
+    WHITE_PAWNS,
+    WHITE_KNIGHTS,
+    WHITE_BISHOPS,
+    WHITE_ROOKS,
+    WHITE_QUEENS,
+    WHITE_KING,
+    WHITE_ALL,
+    BLACK_PAWNS,
+    BLACK_KNIGHTS,
+    BLACK_BISHOPS,
+    BLACK_ROOKS,
+    BLACK_QUEENS,
+    BLACK_KING,
+    BLACK_ALL,
+    EMPTY_SQUARES
+};
+
+// Castling rights bits
+enum CastlingRights
+{
+    WHITE_KINGSIDE = 1,
+    WHITE_QUEENSIDE = 2,
+    BLACK_KINGSIDE = 4,
+    BLACK_QUEENSIDE = 8
+};
+
+constexpr int NO_SQUARE = -1;
+
+//
+// Compact chess position: one bitboard per piece type and color, a mailbox of which bitboard
+// each square belongs to, and the side to move / castling / en passant / halfmove state.
+// Moves are made and unmade incrementally by XORing the from and to squares in and out.
+//
+class Position
+{
+public:
+    Position();
+
+    // Loads a position from a FEN string, returns false if the placement can't be read
+    bool setFEN(const std::string& fen);
+    // The 64 character piece string in the same format as Chess::stateString()
+    std::string stateString() const;
+
+    void makeMove(const BitMove& move);
+    void unmakeMove(const BitMove& move);
+
+    // 64-bit Zobrist key of the position, kept up to date by makeMove/unmakeMove
+    uint64_t getZobristKey() const { return _zobristKey; }
+    // Recomputes the Zobrist key from scratch, for setting up and checking the incremental one
+    uint64_t computeZobristKey() const;
+    // Zobrist key of the pawns alone, for the pawn hash table
+    uint64_t getPawnKey() const { return _pawnKey; }
+    uint64_t computePawnKey() const;
+    // Material signature: the count of every piece type packed four bits each, by bitboard index.
+    // Exact rather than hashed, so two positions share it only if they have the same material.
+    uint64_t getMaterialKey() const { return _materialKey; }
+    int pieceCount(int piece) const { return (int)(_materialKey >> (piece * 4)) & 15; }
+    // True if the current position already occurred since the last capture or pawn move
+    bool isRepetition() const;
+
+    uint64_t getBitboard(int index) const { return _bitboards[index].getData(); }
+    uint64_t getOccupied() const { return _bitboards[WHITE_ALL].getData() | _bitboards[BLACK_ALL].getData(); }
+    // Bitboard index (WHITE_PAWNS .. BLACK_KING) of the piece on a square, or EMPTY_SQUARES
+    int pieceOn(int square) const { return _mailbox[square]; }
+
+    int getSideToMove() const { return _sideToMove; }
+    int getCastlingRights() const { return _castlingRights; }
+    int getEnPassantSquare() const { return _enPassantSquare; }
+    int getHalfmoveClock() const { return _halfmoveClock; }
+    int getFullmoveNumber() const { return _fullmoveNumber; }
+
+    // Squares attacked by each side, and the enemy pieces checking the side to move's king. Worked
+    // out once per position by setFEN/makeMove (and restored by unmakeMove), so check detection,
+    // castling and evaluation all share them instead of each finding attacks again.
+    uint64_t getAttacks(int color) const { return _attacks[color]; }
+    uint64_t getCheckers() const { return _checkers; }
+    bool inCheck() const { return _checkers != 0; }
+
+    // Material plus piece-square totals (white minus black) for the middlegame and the endgame,
+    // and the game phase they are blended by, all kept up to date as pieces move
+    int getMiddlegameScore() const { return _middlegameScore; }
+    int getEndgameScore() const { return _endgameScore; }
+    int getPhase() const { return _phase; }
+    // Evaluation in centipawns from white's point of view: the network's if one is set, otherwise
+    // the tapered material and piece-square score
+    int evaluate() const;
+    // Recomputes the middlegame/endgame totals and the phase from scratch, for setting up and
+    // checking the incremental ones
+    void computeEvaluation(int& middlegame, int& endgame, int& phase) const;
+
+    // Evaluates with a neural network, whose accumulators are then kept up to date by makeMove and
+    // unmakeMove. Pass nullptr (or a network that isn't loaded) to go back to the tables. Set it
+    // before making moves: moves made before it is set can't be unmade with it.
+    void setNetwork(const NNUE::Network* network);
+    const NNUE::Network* getNetwork() const { return _network; }
+    // Rebuilds both accumulators from the pieces on the board, for setting up and checking the incremental ones
+    void computeAccumulator(NNUE::Accumulator& accumulator) const;
+
+private:
+    // Everything makeMove can't recompute when it is undone
+    struct UndoInfo
+    {
+        uint64_t zobristKey;
+        uint8_t captured;
+        uint8_t castlingRights;
+        int8_t enPassantSquare;
+        uint16_t halfmoveClock;
+        uint64_t attacks[2];
+        uint64_t checkers;
+    };
+
+    void clear();
+    void movePiece(int piece, int from, int to);
+    void togglePiece(int piece, int square);
+    void updateAttacks();
+    int activeFeatures(int perspective, int* features) const;
+    void updateAccumulator(const BitMove& move, int piece, int captured, int captureSquare);
+
+    Bitboard _bitboards[14];
+    uint8_t _mailbox[64];
+    int _sideToMove;
+    int _castlingRights;
+    int _enPassantSquare;
+    int _halfmoveClock;
+    int _fullmoveNumber;
+    uint64_t _zobristKey;
+    uint64_t _pawnKey;
+    uint64_t _materialKey;
+    uint64_t _attacks[2];
+    uint64_t _checkers;
+    int _middlegameScore;
+    int _endgameScore;
+    int _phase;
+    const NNUE::Network* _network;
+    NNUE::Accumulator _accumulator;
+
+    std::vector<UndoInfo> _history;
+    // The accumulator before each move in _history, only kept while a network is set
+    std::vector<NNUE::Accumulator> _accumulatorHistory;
+};
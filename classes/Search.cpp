@@ -0,0 +1,449 @@
+#include "Search.h"
+#include "MovePicker.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Mate and tablebase scores are stored relative to the node they were found at, not the root
+static int scoreToTT(int score, int ply)
+{
+    if (score >= SCORE_TB_WIN_IN_MAX_PLY) return score + ply;
+    if (score <= -SCORE_TB_WIN_IN_MAX_PLY) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply)
+{
+    if (score >= SCORE_TB_WIN_IN_MAX_PLY) return score - ply;
+    if (score <= -SCORE_TB_WIN_IN_MAX_PLY) return score + ply;
+    return score;
+}
+
+std::string SearchInfo::toString() const
+{
+    std::string s = "depth " + std::to_string(depth) + " score ";
+    if (score >= SCORE_MATE_IN_MAX_PLY) s += "mate " + std::to_string((SCORE_MATE - score + 1) / 2);
+    else if (score <= -SCORE_MATE_IN_MAX_PLY) s += "mate -" + std::to_string((SCORE_MATE + score) / 2);
+    else s += "cp " + std::to_string(score);
+    s += " nodes " + std::to_string(nodes);
+    s += " nps " + std::to_string(nodesPerSecond);
+    s += " time " + std::to_string((int)(seconds * 1000));
+    if (pawnProbes > 0)
+    {
+        uint64_t permille = pawnHits * 1000 / pawnProbes;
+        s += " pawnhash " + std::to_string(permille / 10) + "." + std::to_string(permille % 10) + "%";
+    }
+    s += " hashfull " + std::to_string(hashfull);
+    if (tbHits > 0) s += " tbhits " + std::to_string(tbHits);
+    if (!pv.empty())
+    {
+        s += " pv";
+        for (auto const & move : pv)
+        {
+            s += ' ';
+            s += move.toString();
+        }
+    }
+    return s;
+}
+
+std::string SearchInfo::threadNodesString() const
+{
+    std::string s = "threads " + std::to_string(threadNodes.size()) + " nodes";
+    for (uint64_t count : threadNodes)
+    {
+        s += ' ';
+        s += std::to_string(count);
+    }
+    return s;
+}
+
+Search::Search(MoveGenerator& moveGenerator, TranspositionTable& transpositionTable)
+    : _moveGenerator(moveGenerator), _transpositionTable(transpositionTable), _stop(false), _timeLimit(0)
+{
+    setThreads(1);
+}
+
+void Search::setThreads(int threads)
+{
+    if (threads < 1) threads = 1;
+    while ((int)_workers.size() > threads) _workers.pop_back();
+    while ((int)_workers.size() < threads)
+    {
+        auto worker = std::make_unique<Worker>();
+        worker->id = (int)_workers.size();
+        worker->nodes = 0;
+        worker->tbHits = 0;
+        worker->pvLength[0] = 0;
+        std::memset(worker->history, 0, sizeof(worker->history));
+        _workers.push_back(std::move(worker));
+    }
+}
+
+//
+// Killers only make sense for the position they were found in, history is kept but faded
+//
+void Search::clearHeuristics(Worker& worker)
+{
+    for (int ply = 0; ply < MAX_PLY; ply++)
+    {
+        worker.killers[ply][0] = BitMove();
+        worker.killers[ply][1] = BitMove();
+    }
+    for (auto& side : worker.history)
+        for (auto& from : side)
+            for (int& entry : from) entry /= 2;
+}
+
+uint64_t Search::getNodes() const
+{
+    uint64_t nodes = 0;
+    for (auto const & worker : _workers) nodes += worker->nodes.load(std::memory_order_relaxed);
+    return nodes;
+}
+
+// Static evaluation from the side to move's point of view
+int Search::evaluate(Worker& worker, const Position& position)
+{
+    int score = worker.evaluator.evaluate(position);
+    return position.getSideToMove() == WHITE ? score : -score;
+}
+
+//
+// Stops the search once the time limit has passed. Only the main thread looks at the clock, every
+// 1024 of its nodes, and not before it has completed an iteration and so has a move to play.
+//
+void Search::checkTime(Worker& worker)
+{
+    if (_timeLimit <= 0 || worker.id != 0 || _bestMove.isNull()) return;
+    if ((worker.nodes.load(std::memory_order_relaxed) & 1023) != 0) return;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime);
+    if (elapsed.count() >= _timeLimit) _stop = true;
+}
+
+BitMove Search::think(const Position& position, int maxDepth, const std::function<void(const SearchInfo&)>& onIteration)
+{
+    _stop = false;
+    _bestMove = BitMove();
+    if (maxDepth < 1) maxDepth = 1;
+    if (maxDepth > MAX_PLY - 1) maxDepth = MAX_PLY - 1;
+
+    for (auto& worker : _workers)
+    {
+        worker->position = position;
+        worker->nodes = 0;
+        worker->tbHits = 0;
+        worker->pvLength[0] = 0;
+        worker->evaluator.getPawnTable().resetStats();
+        clearHeuristics(*worker);
+    }
+    _startTime = std::chrono::steady_clock::now();
+
+    // In a position the tablebases cover, only search the root moves that keep the best result
+    _rootMoves.clear();
+    Position& root = _workers[0]->position;
+    if (root.getCastlingRights() == 0 && Bitboard(root.getOccupied()).countBits() <= Tablebases::maxPieces())
+    {
+        Tablebases::rankRootMoves(root, _moveGenerator, _rootMoves);
+    }
+
+    // Helpers don't stop at maxDepth, they keep filling the table until the main thread is done
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < _workers.size(); i++)
+    {
+        helpers.emplace_back([this, i]() { iterate(*_workers[i], MAX_PLY - 1, nullptr); });
+    }
+
+    iterate(*_workers[0], maxDepth, onIteration);
+
+    _stop = true;
+    for (auto& helper : helpers) helper.join();
+    return _bestMove;
+}
+
+//
+// Iterative deepening for one thread. Helpers start one ply deeper on every other thread and
+// skip ahead a ply now and then, so they spend most of their time on different depths than the
+// main thread and feed it entries it hasn't searched yet.
+//
+void Search::iterate(Worker& worker, int maxDepth, const std::function<void(const SearchInfo&)>& onIteration)
+{
+    bool mainThread = worker.id == 0;
+    int score = 0;
+
+    for (int depth = 1 + (worker.id & 1); depth <= maxDepth; depth++)
+    {
+        if (!mainThread && depth > 2 && (depth + worker.id) % 4 == 0) depth++;
+        if (depth > maxDepth) break;
+
+        score = aspiration(worker, depth, score);
+        if (_stop) break;
+        if (!mainThread) continue;
+
+        // Only a completed iteration is trusted
+        if (worker.pvLength[0] > 0) _bestMove = worker.pv[0][0];
+
+        auto now = std::chrono::steady_clock::now();
+        SearchInfo info;
+        info.depth = depth;
+        info.score = score;
+        for (auto const & w : _workers) info.threadNodes.push_back(w->nodes.load(std::memory_order_relaxed));
+        info.nodes = 0;
+        for (uint64_t count : info.threadNodes) info.nodes += count;
+        info.seconds = std::chrono::duration<double>(now - _startTime).count();
+        info.nodesPerSecond = info.seconds > 0 ? (uint64_t)(info.nodes / info.seconds) : 0;
+        info.pawnProbes = worker.evaluator.getPawnTable().getProbes();
+        info.pawnHits = worker.evaluator.getPawnTable().getHits();
+        info.hashfull = _transpositionTable.hashfull();
+        info.tbHits = 0;
+        for (auto const & w : _workers) info.tbHits += w->tbHits.load(std::memory_order_relaxed);
+        info.pv.assign(worker.pv[0], worker.pv[0] + worker.pvLength[0]);
+        if (onIteration) onIteration(info);
+
+        // No point searching deeper once a forced mate has been found
+        if (score >= SCORE_MATE_IN_MAX_PLY || score <= -SCORE_MATE_IN_MAX_PLY) break;
+    }
+}
+
+//
+// Searches with a narrow window around the last iteration's score, widening it on the side
+// that failed until the score lands inside
+//
+int Search::aspiration(Worker& worker, int depth, int previousScore)
+{
+    int window = 25;
+    int alpha = -SCORE_INFINITE;
+    int beta = SCORE_INFINITE;
+    if (depth >= 4)
+    {
+        alpha = std::max(previousScore - window, -SCORE_INFINITE);
+        beta = std::min(previousScore + window, SCORE_INFINITE);
+    }
+
+    while (true)
+    {
+        int score = negamax(worker, alpha, beta, depth, 0);
+        if (_stop) return score;
+
+        if (score <= alpha)
+        {
+            beta = (alpha + beta) / 2;
+            alpha = std::max(score - window, -SCORE_INFINITE);
+        }
+        else if (score >= beta)
+        {
+            beta = std::min(score + window, SCORE_INFINITE);
+        }
+        else
+        {
+            return score;
+        }
+        window *= 2;
+    }
+}
+
+//
+// Searches captures only until the position is quiet, so the static evaluation is never taken in
+// the middle of an exchange. The side to move may "stand pat" on the evaluation instead of
+// capturing, and captures that lose material by static exchange evaluation are skipped. In check
+// every evasion is searched, since standing pat isn't an option there.
+//
+int Search::quiescence(Worker& worker, int alpha, int beta, int ply)
+{
+    Position& position = worker.position;
+    worker.pvLength[ply] = 0;
+    if (_stop.load(std::memory_order_relaxed)) return 0;
+    worker.nodes.store(worker.nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    checkTime(worker);
+
+    if (ply >= MAX_PLY - 1) return evaluate(worker, position);
+
+    bool inCheck = _moveGenerator.isInCheck(position);
+    int bestScore = -SCORE_INFINITE;
+    if (!inCheck)
+    {
+        bestScore = evaluate(worker, position);
+        if (bestScore >= beta) return bestScore;
+        if (bestScore > alpha) alpha = bestScore;
+    }
+
+    static const BitMove noKillers[2];
+    MovePicker picker = inCheck ? MovePicker(_moveGenerator, position, BitMove(), noKillers, worker.history)
+                                : MovePicker(_moveGenerator, position, worker.history);
+    BitMove move;
+    int movesSearched = 0;
+    while (picker.next(move))
+    {
+        movesSearched++;
+        if (!inCheck && move.isPromotion() && move.promotionPiece() != Queen) continue;
+        if (!inCheck && _moveGenerator.see(position, move) < 0) continue;
+
+        position.makeMove(move);
+        int score = -quiescence(worker, -beta, -alpha, ply + 1);
+        position.unmakeMove(move);
+        if (_stop.load(std::memory_order_relaxed)) return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            if (score > alpha)
+            {
+                alpha = score;
+                worker.pv[ply][0] = move;
+                for (int j = 0; j < worker.pvLength[ply + 1]; j++) worker.pv[ply][j + 1] = worker.pv[ply + 1][j];
+                worker.pvLength[ply] = worker.pvLength[ply + 1] + 1;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+
+    if (inCheck && movesSearched == 0) return -SCORE_MATE + ply;
+    return bestScore;
+}
+
+//
+// A quiet move caused a cutoff: make it a killer for this ply and move its history up, and the
+// history of the quiet moves that were tried before it down
+//
+void Search::updateQuietStats(Worker& worker, int side, int ply, int depth, const BitMove& move, const BitMove* quietsSearched, int quietCount)
+{
+    if (!(worker.killers[ply][0] == move))
+    {
+        worker.killers[ply][1] = worker.killers[ply][0];
+        worker.killers[ply][0] = move;
+    }
+
+    int bonus = std::min(depth * depth, 400);
+    // Scaling by how far the entry already is from zero keeps every entry within +-MAX_HISTORY
+    auto update = [&](const BitMove& m, int amount)
+    {
+        int& entry = worker.history[side][m.from][m.to];
+        entry += amount - entry * std::abs(amount) / MAX_HISTORY;
+    };
+    update(move, bonus);
+    for (int i = 0; i < quietCount; i++) update(quietsSearched[i], -bonus);
+}
+
+int Search::negamax(Worker& worker, int alpha, int beta, int depth, int ply)
+{
+    Position& position = worker.position;
+    worker.pvLength[ply] = 0;
+    if (_stop.load(std::memory_order_relaxed)) return 0;
+    worker.nodes.store(worker.nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    checkTime(worker);
+
+    bool rootNode = ply == 0;
+    bool pvNode = beta - alpha > 1;
+
+    if (!rootNode)
+    {
+        if (position.isRepetition() || position.getHalfmoveClock() >= 100) return 0;
+        // Nothing left to mate with, or a bitbase knows it is a draw, so there is nothing to search for
+        if (worker.evaluator.isDrawn(position)) return 0;
+        if (ply >= MAX_PLY - 1) return evaluate(worker, position);
+    }
+
+    if (depth <= 0) return quiescence(worker, alpha, beta, ply);
+
+    // Transposition table cutoff, never in PV nodes so the principal variation stays whole
+    uint64_t key = position.getZobristKey();
+    TTData ttData;
+    bool ttHit = _transpositionTable.probe(key, ttData);
+    BitMove ttMove = ttHit ? ttData.move : BitMove();
+    if (ttHit && !pvNode && ttData.depth >= depth)
+    {
+        int ttScore = scoreFromTT(ttData.score, ply);
+        if (ttData.bound == BOUND_EXACT ||
+            (ttData.bound == BOUND_LOWER && ttScore >= beta) ||
+            (ttData.bound == BOUND_UPPER && ttScore <= alpha))
+        {
+            return ttScore;
+        }
+    }
+
+    // The WDL tables assume no castling and a fifty move count of zero, so they are only probed
+    // right after a capture or pawn move. Cursed wins and blessed losses are draws here.
+    if (!rootNode && position.getHalfmoveClock() == 0 && position.getCastlingRights() == 0 &&
+        Bitboard(position.getOccupied()).countBits() <= Tablebases::maxPieces())
+    {
+        Tablebases::WDLScore wdl;
+        if (Tablebases::probeWDL(position, _moveGenerator, wdl))
+        {
+            worker.tbHits.store(worker.tbHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            int score = wdl == Tablebases::WDL_WIN ? SCORE_TB_WIN - ply : wdl == Tablebases::WDL_LOSS ? -SCORE_TB_WIN + ply : 0;
+            TTBound bound = wdl == Tablebases::WDL_WIN ? BOUND_LOWER : wdl == Tablebases::WDL_LOSS ? BOUND_UPPER : BOUND_EXACT;
+            if (bound == BOUND_EXACT || (bound == BOUND_LOWER ? score >= beta : score <= alpha))
+            {
+                _transpositionTable.store(key, BitMove(), scoreToTT(score, ply), std::min(depth + 6, MAX_PLY - 1), bound);
+                return score;
+            }
+        }
+    }
+
+    int side = position.getSideToMove();
+    MovePicker picker(_moveGenerator, position, ttMove, worker.killers[ply], worker.history);
+
+    int originalAlpha = alpha;
+    int bestScore = -SCORE_INFINITE;
+    BitMove bestMove;
+    BitMove move;
+    int movesSearched = 0;
+    // Quiet moves tried before the current one, to be penalised if a later one cuts off
+    BitMove quietsSearched[64];
+    int quietCount = 0;
+
+    while (picker.next(move))
+    {
+        if (rootNode && !_rootMoves.empty() && std::find(_rootMoves.begin(), _rootMoves.end(), move) == _rootMoves.end()) continue;
+        bool capture = move.isCaptureOrPromotion();
+        position.makeMove(move);
+        _transpositionTable.prefetch(position.getZobristKey());
+
+        int score;
+        if (movesSearched++ == 0)
+        {
+            score = -negamax(worker, -beta, -alpha, depth - 1, ply + 1);
+        }
+        else
+        {
+            // Principal variation search: prove the move is no better with a null window,
+            // and only search it again with the full window if that fails
+            score = -negamax(worker, -alpha - 1, -alpha, depth - 1, ply + 1);
+            if (score > alpha && score < beta) score = -negamax(worker, -beta, -alpha, depth - 1, ply + 1);
+        }
+
+        position.unmakeMove(move);
+        if (_stop.load(std::memory_order_relaxed)) return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = move;
+            if (score > alpha)
+            {
+                alpha = score;
+                worker.pv[ply][0] = move;
+                for (int j = 0; j < worker.pvLength[ply + 1]; j++) worker.pv[ply][j + 1] = worker.pv[ply + 1][j];
+                worker.pvLength[ply] = worker.pvLength[ply + 1] + 1;
+                if (alpha >= beta)
+                {
+                    if (!capture) updateQuietStats(worker, side, ply, depth, move, quietsSearched, quietCount);
+                    break;
+                }
+            }
+        }
+        if (!capture && quietCount < 64) quietsSearched[quietCount++] = move;
+    }
+
+    if (movesSearched == 0)
+    {
+        // Checkmate or stalemate
+        return _moveGenerator.isInCheck(position) ? -SCORE_MATE + ply : 0;
+    }
+
+    TTBound bound = bestScore >= beta ? BOUND_LOWER : (bestScore > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    _transpositionTable.store(key, bestMove, scoreToTT(bestScore, ply), depth, bound);
+
+    return bestScore;
+}
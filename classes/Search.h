@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Position.h"
+#include "MoveGenerator.h"
+#include "TranspositionTable.h"
+#include "MovePicker.h"
+#include "Evaluator.h"
+#include "Tablebases.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+constexpr int MAX_PLY = 128;
+constexpr int SCORE_INFINITE = 32000;
+constexpr int SCORE_MATE = 31000;
+constexpr int SCORE_MATE_IN_MAX_PLY = SCORE_MATE - MAX_PLY;
+// Tablebase wins score below every mate, and like mates they count down with the distance from the root
+constexpr int SCORE_TB_WIN = SCORE_MATE_IN_MAX_PLY - 1;
+constexpr int SCORE_TB_WIN_IN_MAX_PLY = SCORE_TB_WIN - MAX_PLY;
+
+// What the search reports after each completed iteration
+struct SearchInfo
+{
+    int depth;
+    int score;
+    uint64_t nodes;
+    double seconds;
+    uint64_t nodesPerSecond;
+    std::vector<BitMove> pv;
+    // Nodes searched by each thread, main thread first; nodes is their sum
+    std::vector<uint64_t> threadNodes;
+    // Pawn hash lookups by the main thread this search, and how many found their entry
+    uint64_t pawnProbes;
+    uint64_t pawnHits;
+    // Permill of the transposition table written this search
+    int hashfull;
+    // Successful tablebase probes by all threads
+    uint64_t tbHits;
+
+    // e.g. "depth 6 score cp 35 nodes 123456 nps 2000000 time 61 pawnhash 97.4% hashfull 3 tbhits 12 pv e2e4 e7e5"
+    std::string toString() const;
+    // e.g. "threads 4 nodes 30012 29877 31002 30519"
+    std::string threadNodesString() const;
+};
+
+//
+// Negamax alpha-beta search with iterative deepening, principal variation search and
+// aspiration windows. Works on its own copy of the position so the caller's board is untouched.
+//
+// With more than one thread the search is Lazy SMP: helper threads search the same root at
+// staggered depths and only talk to the main thread through the shared transposition table.
+// The main thread decides the move and the helpers are stopped as soon as it is done.
+//
+class Search
+{
+public:
+    Search(MoveGenerator& moveGenerator, TranspositionTable& transpositionTable);
+
+    // Number of threads to search with, including the calling thread
+    void setThreads(int threads);
+    int getThreads() const { return (int)_workers.size(); }
+
+    // Stops searching once this many milliseconds have gone by, keeping the last completed
+    // iteration's move; 0 searches to maxDepth however long it takes. The first iteration always
+    // completes, so there is always a move.
+    void setTimeLimit(int milliseconds) { _timeLimit = milliseconds; }
+
+    // Searches to maxDepth and returns the best move found, calling onIteration after each depth
+    BitMove think(const Position& position, int maxDepth, const std::function<void(const SearchInfo&)>& onIteration);
+    // Can be called from another thread; think returns the last completed iteration's move
+    void stop() { _stop = true; }
+
+    // Nodes searched by all threads in the last (or current) search
+    uint64_t getNodes() const;
+
+private:
+    // Everything one search thread writes while it searches
+    struct Worker
+    {
+        int id;
+        Position position;
+        // Only this worker writes it, the main thread reads it for reporting
+        std::atomic<uint64_t> nodes;
+        std::atomic<uint64_t> tbHits;
+
+        // Triangular principal variation table
+        BitMove pv[MAX_PLY][MAX_PLY];
+        int pvLength[MAX_PLY];
+
+        // Move ordering: two quiet moves per ply that caused a cutoff, and quiet move history
+        BitMove killers[MAX_PLY][2];
+        HistoryTable history;
+
+        // Static evaluation with its pawn and material caches, kept from one search to the next
+        Evaluator evaluator;
+    };
+
+    void iterate(Worker& worker, int maxDepth, const std::function<void(const SearchInfo&)>& onIteration);
+    int aspiration(Worker& worker, int depth, int previousScore);
+    int negamax(Worker& worker, int alpha, int beta, int depth, int ply);
+    int quiescence(Worker& worker, int alpha, int beta, int ply);
+    void updateQuietStats(Worker& worker, int side, int ply, int depth, const BitMove& move, const BitMove* quietsSearched, int quietCount);
+    void clearHeuristics(Worker& worker);
+    int evaluate(Worker& worker, const Position& position);
+    void checkTime(Worker& worker);
+
+    MoveGenerator& _moveGenerator;
+    TranspositionTable& _transpositionTable;
+    std::atomic<bool> _stop;
+    int _timeLimit;
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    // Root moves the tablebases say keep the best result, only these are searched; empty to search them all
+    std::vector<BitMove> _rootMoves;
+    BitMove _bestMove;
+    std::chrono::steady_clock::time_point _startTime;
+};
@@ -0,0 +1,1090 @@
+//
+// Syzygy probing code ported from Stockfish (src/syzygy/tbprobe.cpp), which builds on the
+// original probing code by Ronald de Man. The index tables, the pairs decoder and the probe
+// logic below follow it closely.
+//
+// Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+// Copyright (C) 2004-2024 The Stockfish developers (see AUTHORS file)
+//
+// Stockfish is free software: you can redistribute it and/or modify it under the terms of the
+// GNU General Public License as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version. It is distributed WITHOUT ANY WARRANTY;
+// without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+// the GNU General Public License for more details: <https://www.gnu.org/licenses/>.
+//
+
+#include "Tablebases.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+namespace Tablebases
+{
+
+//
+// Everything below follows the Syzygy file format: how positions are numbered, and how the
+// numbered results are compressed (Huffman codes of symbols that each expand to a run of values,
+// "recursive pairing"). Multi-byte numbers are little endian except for the Huffman code stream.
+//
+
+enum TableType
+{
+    WDL,
+    DTZ
+};
+
+enum ProbeState
+{
+    PROBE_FAIL,
+    PROBE_OK,
+    // DTZ files only hold one side to move, and this position has the other one
+    PROBE_CHANGE_STM,
+    // The best move is a capture or a pawn move, so DTZ is known without the DTZ table
+    PROBE_ZEROING_BEST_MOVE
+};
+
+// Per table and file flags
+enum TableFlags
+{
+    FLAG_STM = 1,
+    FLAG_MAPPED = 2,
+    FLAG_WIN_PLIES = 4,
+    FLAG_LOSS_PLIES = 8,
+    FLAG_WIDE = 16,
+    FLAG_SINGLE_VALUE = 128
+};
+
+// Pieces in the files are 1 to 6 for white pawn to king, and the same plus 8 for black
+constexpr int TB_BLACK = 8;
+
+static inline int fileOf(int square) { return square & 7; }
+static inline int rankOf(int square) { return square >> 3; }
+// Above (positive), on (0) or below (negative) the a1-h8 diagonal
+static inline int offA1H8(int square) { return rankOf(square) - fileOf(square); }
+
+template <typename T>
+static inline T readLittle(const uint8_t* bytes)
+{
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) value |= (T)bytes[i] << (8 * i);
+    return value;
+}
+
+template <typename T>
+static inline T readBig(const uint8_t* bytes)
+{
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) value = (T)((value << 8) | bytes[i]);
+    return value;
+}
+
+//
+// Index tables
+//
+static int MapPawns[64];
+static int MapB1H1H7[64];
+static int MapA1D1D4[64];
+static int MapKK[10][64];
+static int Binomial[6][64];
+static int LeadPawnIdx[6][64];
+static int LeadPawnsSize[6][4];
+static std::once_flag IndexTablesInitialized;
+
+static void initIndexTables()
+{
+    // b1-h1-h7 triangle (below the diagonal) to 0..27
+    int code = 0;
+    for (int s = 0; s < 64; s++)
+    {
+        if (offA1H8(s) < 0) MapB1H1H7[s] = code++;
+    }
+
+    // a1-d1-d4 triangle to 0..9, the diagonal squares last
+    std::vector<int> diagonal;
+    code = 0;
+    for (int s : { 0, 1, 2, 3, 8, 9, 10, 11, 16, 17, 18, 19, 24, 25, 26, 27 })
+    {
+        if (offA1H8(s) < 0) MapA1D1D4[s] = code++;
+        else if (offA1H8(s) == 0) diagonal.push_back(s);
+    }
+    for (int s : diagonal) MapA1D1D4[s] = code++;
+
+    // The 462 legal placements of two kings with the first in the a1-d1-d4 triangle, and the
+    // second not above the diagonal if the first is on it. Both on the diagonal come last.
+    std::vector<std::pair<int, int>> bothOnDiagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++)
+    {
+        for (int s1 = 0; s1 <= 27; s1++)
+        {
+            // Squares outside the triangle map to 0 as well, b1 is the one that really does
+            if (MapA1D1D4[s1] != idx || (idx == 0 && s1 != 1)) continue;
+            for (int s2 = 0; s2 < 64; s2++)
+            {
+                if (((MoveGenerator::pieceAttacks(King, s1, 0ULL) | (1ULL << s1)) >> s2) & 1) continue;
+                if (offA1H8(s1) == 0 && offA1H8(s2) > 0) continue;
+                if (offA1H8(s1) == 0 && offA1H8(s2) == 0) bothOnDiagonal.emplace_back(idx, s2);
+                else MapKK[idx][s2] = code++;
+            }
+        }
+    }
+    for (auto& kings : bothOnDiagonal) MapKK[kings.first][kings.second] = code++;
+
+    Binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++)
+    {
+        for (int k = 0; k < 6 && k <= n; k++)
+        {
+            Binomial[k][n] = (k > 0 ? Binomial[k - 1][n - 1] : 0) + (k < n ? Binomial[k][n - 1] : 0);
+        }
+    }
+
+    // Pawn squares a2-h7 numbered so that the leading pawn (nearest the edge, then lowest rank)
+    // has the highest number, which is also how many squares are left for the other pawns
+    int availableSquares = 47;
+    for (int leadPawns = 1; leadPawns <= 5; leadPawns++)
+    {
+        for (int file = 0; file < 4; file++)
+        {
+            int idx = 0;
+            for (int rank = 1; rank <= 6; rank++)
+            {
+                int square = rank * 8 + file;
+                if (leadPawns == 1)
+                {
+                    MapPawns[square] = availableSquares--;
+                    MapPawns[square ^ 7] = availableSquares--;
+                }
+                LeadPawnIdx[leadPawns][square] = idx;
+                idx += Binomial[leadPawns - 1][MapPawns[square]];
+            }
+            LeadPawnsSize[leadPawns][file] = idx;
+        }
+    }
+}
+
+//
+// One compressed block of results: for a WDL table one per side to move, and for tables with
+// pawns one per file the leading pawn can be on
+//
+struct PairsData
+{
+    uint8_t flags = 0;
+    uint8_t maxSymLen = 0;
+    uint8_t minSymLen = 0;
+    uint32_t numBlocks = 0;
+    size_t sizeofBlock = 0;
+    size_t span = 0;
+    // Little endian uint16 lowest symbol of each code length
+    const uint8_t* lowestSym = nullptr;
+    // Three bytes a symbol: the 12 bit left and right symbols it expands to
+    const uint8_t* btree = nullptr;
+    // Little endian uint16 values per block, minus one
+    const uint8_t* blockLength = nullptr;
+    uint32_t blockLengthSize = 0;
+    // Six bytes an entry: uint32 block and uint16 offset of every span'th value
+    const uint8_t* sparseIndex = nullptr;
+    size_t sparseIndexSize = 0;
+    const uint8_t* data = nullptr;
+    std::vector<uint64_t> base64;
+    std::vector<uint8_t> symlen;
+    uint8_t pieces[MAX_PIECES] = {};
+    uint64_t groupIdx[MAX_PIECES + 1] = {};
+    int groupLen[MAX_PIECES + 1] = {};
+    // Where each result's DTZ value map starts, DTZ tables only
+    uint16_t mapIdx[4] = {};
+
+    int leftSymbol(int sym) const { const uint8_t* lr = btree + 3 * sym; return ((lr[1] & 0xF) << 8) | lr[0]; }
+    int rightSymbol(int sym) const { const uint8_t* lr = btree + 3 * sym; return (lr[2] << 4) | (lr[1] >> 4); }
+};
+
+struct Table
+{
+    TableType type;
+    // Set once the file has been looked at, mapped or not
+    std::atomic<bool> ready;
+    bool usable;
+    MappedFile file;
+    std::string path;
+    // DTZ value maps
+    const uint8_t* map;
+    // Material keys with the stronger side white, and with it black
+    uint64_t key;
+    uint64_t key2;
+    int pieceCount;
+    bool hasPawns;
+    bool hasUniquePieces;
+    // Pawns of the leading color, and of the other one
+    uint8_t pawnCount[2];
+    PairsData items[2][4];
+
+    Table(TableType type) : type(type), ready(false), usable(false), map(nullptr), key(0), key2(0), pieceCount(0),
+                            hasPawns(false), hasUniquePieces(false), pawnCount{0, 0} { }
+
+    int sides() const { return type == WDL ? 2 : 1; }
+    PairsData* get(int stm, int file) { return &items[stm % sides()][hasPawns ? file : 0]; }
+};
+
+struct TableEntry
+{
+    Table* wdl;
+    Table* dtz;
+};
+
+static std::deque<Table> Tables;
+static std::unordered_map<uint64_t, TableEntry> Registry;
+static int MaxPieces = 0;
+
+//
+// Parsing a mapped file
+//
+
+// Symbols expand recursively, so count how many values each one stands for
+static int setSymlen(PairsData* d, int sym, std::vector<bool>& visited)
+{
+    visited[sym] = true;
+    int right = d->rightSymbol(sym);
+    if (right == 0xFFF) return 0;
+    int left = d->leftSymbol(sym);
+    if (!visited[left]) d->symlen[left] = (uint8_t)setSymlen(d, left, visited);
+    if (!visited[right]) d->symlen[right] = (uint8_t)setSymlen(d, right, visited);
+    return d->symlen[left] + d->symlen[right] + 1;
+}
+
+//
+// Splits the pieces into the groups they are numbered by (the leading pieces or pawns, the
+// other side's pawns, then runs of like pieces) and works out each group's multiplier. The order
+// the groups are multiplied in is stored per table.
+//
+static void setGroups(Table& table, PairsData* d, const int order[2], int file)
+{
+    int n = 0;
+    int firstLen = table.hasPawns ? 0 : table.hasUniquePieces ? 3 : 2;
+    d->groupLen[n] = 1;
+    for (int i = 1; i < table.pieceCount; i++)
+    {
+        if (--firstLen > 0 || d->pieces[i] != d->pieces[i - 1]) d->groupLen[++n] = 1;
+        else d->groupLen[n]++;
+    }
+    d->groupLen[++n] = 0;
+
+    bool bothPawns = table.hasPawns && table.pawnCount[1];
+    int next = bothPawns ? 2 : 1;
+    int freeSquares = 64 - d->groupLen[0] - (bothPawns ? d->groupLen[1] : 0);
+    uint64_t idx = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++)
+    {
+        if (k == order[0])
+        {
+            d->groupIdx[0] = idx;
+            idx *= table.hasPawns ? LeadPawnsSize[d->groupLen[0]][file] : table.hasUniquePieces ? 31332 : 462;
+        }
+        else if (k == order[1])
+        {
+            d->groupIdx[1] = idx;
+            idx *= Binomial[d->groupLen[1]][48 - d->groupLen[0]];
+        }
+        else
+        {
+            d->groupIdx[next] = idx;
+            idx *= Binomial[d->groupLen[next]][freeSquares];
+            freeSquares -= d->groupLen[next++];
+        }
+    }
+    d->groupIdx[n] = idx;
+}
+
+static const uint8_t* setSizes(PairsData* d, const uint8_t* data)
+{
+    d->flags = *data++;
+    if (d->flags & FLAG_SINGLE_VALUE)
+    {
+        d->numBlocks = d->blockLengthSize = 0;
+        d->sparseIndexSize = 0;
+        // The one value every position has
+        d->minSymLen = *data++;
+        return data;
+    }
+
+    // groupIdx after the last group is the number of positions in the table
+    int groups = 0;
+    while (d->groupLen[groups]) groups++;
+    uint64_t tableSize = d->groupIdx[groups];
+
+    d->sizeofBlock = (size_t)1 << *data++;
+    d->span = (size_t)1 << *data++;
+    d->sparseIndexSize = (size_t)((tableSize + d->span - 1) / d->span);
+    int padding = *data++;
+    d->numBlocks = readLittle<uint32_t>(data);
+    data += sizeof(uint32_t);
+    // Padded so the sparse index never points past the end
+    d->blockLengthSize = d->numBlocks + padding;
+    d->maxSymLen = *data++;
+    d->minSymLen = *data++;
+    d->lowestSym = data;
+    d->base64.resize(d->maxSymLen - d->minSymLen + 1);
+
+    // Canonical Huffman codes: longer codes have lower values. base64[len] is the lowest code of
+    // each length, left aligned in 64 bits, so a code's length is the first len whose base it
+    // is at or above.
+    for (int i = (int)d->base64.size() - 2; i >= 0; i--)
+    {
+        d->base64[i] = (d->base64[i + 1] + readLittle<uint16_t>(d->lowestSym + 2 * i) - readLittle<uint16_t>(d->lowestSym + 2 * (i + 1))) / 2;
+    }
+    for (size_t i = 0; i < d->base64.size(); i++) d->base64[i] <<= 64 - i - d->minSymLen;
+
+    data += d->base64.size() * sizeof(uint16_t);
+    d->symlen.resize(readLittle<uint16_t>(data));
+    data += sizeof(uint16_t);
+    d->btree = data;
+
+    std::vector<bool> visited(d->symlen.size());
+    for (size_t sym = 0; sym < d->symlen.size(); sym++)
+    {
+        if (!visited[sym]) d->symlen[sym] = (uint8_t)setSymlen(d, (int)sym, visited);
+    }
+    return data + d->symlen.size() * 3 + (d->symlen.size() & 1);
+}
+
+static const uint8_t* setDtzMap(Table& table, const uint8_t* data, int maxFile)
+{
+    table.map = data;
+    for (int file = 0; file <= maxFile; file++)
+    {
+        PairsData* d = table.get(0, file);
+        if (!(d->flags & FLAG_MAPPED)) continue;
+        if (d->flags & FLAG_WIDE)
+        {
+            data += (uintptr_t)data & 1;
+            for (int i = 0; i < 4; i++)
+            {
+                d->mapIdx[i] = (uint16_t)((data - table.map) / 2 + 1);
+                data += 2 * readLittle<uint16_t>(data) + 2;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                d->mapIdx[i] = (uint16_t)(data - table.map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+    return data + ((uintptr_t)data & 1);
+}
+
+// Reads the header after the magic number and points every block of results into the file
+static bool setup(Table& table, const uint8_t* data)
+{
+    constexpr int Split = 1;
+    constexpr int HasPawns = 2;
+    if (table.hasPawns != bool(*data & HasPawns) || (table.key != table.key2) != bool(*data & Split)) return false;
+    data++;
+
+    int sides = table.type == WDL && table.key != table.key2 ? 2 : 1;
+    int maxFile = table.hasPawns ? 3 : 0;
+    bool bothPawns = table.hasPawns && table.pawnCount[1];
+
+    for (int file = 0; file <= maxFile; file++)
+    {
+        for (int i = 0; i < sides; i++) *table.get(i, file) = PairsData();
+
+        int order[2][2] = { { *data & 0xF, bothPawns ? *(data + 1) & 0xF : 0xF },
+                            { *data >> 4, bothPawns ? *(data + 1) >> 4 : 0xF } };
+        data += 1 + bothPawns;
+
+        for (int k = 0; k < table.pieceCount; k++, data++)
+        {
+            for (int i = 0; i < sides; i++) table.get(i, file)->pieces[k] = (uint8_t)(i ? *data >> 4 : *data & 0xF);
+        }
+        for (int i = 0; i < sides; i++) setGroups(table, table.get(i, file), order[i], file);
+    }
+
+    data += (uintptr_t)data & 1;
+    for (int file = 0; file <= maxFile; file++)
+    {
+        for (int i = 0; i < sides; i++) data = setSizes(table.get(i, file), data);
+    }
+    if (table.type == DTZ) data = setDtzMap(table, data, maxFile);
+
+    for (int file = 0; file <= maxFile; file++)
+    {
+        for (int i = 0; i < sides; i++)
+        {
+            PairsData* d = table.get(i, file);
+            d->sparseIndex = data;
+            data += d->sparseIndexSize * 6;
+        }
+    }
+    for (int file = 0; file <= maxFile; file++)
+    {
+        for (int i = 0; i < sides; i++)
+        {
+            PairsData* d = table.get(i, file);
+            d->blockLength = data;
+            data += d->blockLengthSize * sizeof(uint16_t);
+        }
+    }
+    for (int file = 0; file <= maxFile; file++)
+    {
+        for (int i = 0; i < sides; i++)
+        {
+            // Blocks start on a 64 byte boundary
+            data = (const uint8_t*)(((uintptr_t)data + 0x3F) & ~(uintptr_t)0x3F);
+            PairsData* d = table.get(i, file);
+            d->data = data;
+            data += (size_t)d->numBlocks * d->sizeofBlock;
+        }
+    }
+    return data <= table.file.getData() + table.file.getSize();
+}
+
+// Maps the table's file the first time any thread needs it. Returns false if it can't be used.
+static bool ensureMapped(Table& table)
+{
+    if (table.ready.load(std::memory_order_acquire)) return table.usable;
+
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (table.ready.load(std::memory_order_relaxed)) return table.usable;
+
+    static const uint8_t Magics[2][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+    if (table.file.map(table.path) && table.file.getSize() > 5 && memcmp(table.file.getData(), Magics[table.type], 4) == 0)
+    {
+        table.usable = setup(table, table.file.getData() + 4);
+    }
+    if (!table.usable) table.file.unmap();
+    table.ready.store(true, std::memory_order_release);
+    return table.usable;
+}
+
+//
+// Finds the value at index idx: the sparse index gives a block near it, the block lengths the
+// exact block, then the block's Huffman codes are read until the symbol covering idx, which is
+// expanded down to the single value.
+//
+static int decompressPairs(const PairsData* d, uint64_t idx)
+{
+    if (d->flags & FLAG_SINGLE_VALUE) return d->minSymLen;
+
+    uint32_t k = (uint32_t)(idx / d->span);
+    uint32_t block = readLittle<uint32_t>(d->sparseIndex + 6 * k);
+    int offset = readLittle<uint16_t>(d->sparseIndex + 6 * k + 4);
+    offset += (int)(idx % d->span) - (int)(d->span / 2);
+
+    while (offset < 0) offset += readLittle<uint16_t>(d->blockLength + 2 * --block) + 1;
+    while (offset > readLittle<uint16_t>(d->blockLength + 2 * block)) offset -= readLittle<uint16_t>(d->blockLength + 2 * block++) + 1;
+
+    const uint8_t* ptr = d->data + (uint64_t)block * d->sizeofBlock;
+    uint64_t buf64 = readBig<uint64_t>(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+
+    while (true)
+    {
+        int len = 0;
+        while (buf64 < d->base64[len]) len++;
+        sym = (int)((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+        sym += readLittle<uint16_t>(d->lowestSym + 2 * len);
+        if (offset < d->symlen[sym] + 1) break;
+
+        offset -= d->symlen[sym] + 1;
+        len += d->minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32)
+        {
+            buf64Size += 32;
+            buf64 |= (uint64_t)readBig<uint32_t>(ptr) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // Each symbol is a pair of adjacent symbols, so walk down to the one holding offset
+    while (d->symlen[sym])
+    {
+        int left = d->leftSymbol(sym);
+        if (offset < d->symlen[left] + 1)
+        {
+            sym = left;
+        }
+        else
+        {
+            offset -= d->symlen[left] + 1;
+            sym = d->rightSymbol(sym);
+        }
+    }
+    return d->leftSymbol(sym);
+}
+
+static int mapScore(Table& table, int file, int value, WDLScore wdl)
+{
+    if (table.type == WDL) return value - 2;
+
+    constexpr int WDLMap[] = { 1, 3, 0, 2, 0 };
+    const PairsData* d = table.get(0, file);
+    if (d->flags & FLAG_MAPPED)
+    {
+        if (d->flags & FLAG_WIDE) value = readLittle<uint16_t>(table.map + 2 * (d->mapIdx[WDLMap[wdl + 2]] + value));
+        else value = table.map[d->mapIdx[WDLMap[wdl + 2]] + value];
+    }
+
+    // Stored in moves unless the flags say plies
+    if ((wdl == WDL_WIN && !(d->flags & FLAG_WIN_PLIES)) || (wdl == WDL_LOSS && !(d->flags & FLAG_LOSS_PLIES)) ||
+        wdl == WDL_CURSED_WIN || wdl == WDL_BLESSED_LOSS)
+    {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+// File code of the piece on a square (1-6 white, 9-14 black)
+static inline int tbPiece(const Position& position, int square)
+{
+    int piece = position.pieceOn(square);
+    return piece < WHITE_ALL ? piece + 1 : piece - BLACK_PAWNS + 1 + TB_BLACK;
+}
+
+static inline bool pawnsBefore(int a, int b)
+{
+    return MapPawns[a] < MapPawns[b];
+}
+
+//
+// Numbers the position the way the table does and looks its value up
+//
+static int probeTable(Position& position, TableType type, ProbeState& state, WDLScore wdl = WDL_DRAW)
+{
+    uint64_t occupied = position.getOccupied();
+    if (Bitboard(occupied).countBits() == 2) return WDL_DRAW;
+
+    auto found = Registry.find(position.getMaterialKey());
+    Table* table = found == Registry.end() ? nullptr : (type == WDL ? found->second.wdl : found->second.dtz);
+    if (!table || !ensureMapped(*table))
+    {
+        state = PROBE_FAIL;
+        return 0;
+    }
+
+    // Tables are stored with the stronger side as white, and only with white to move when both
+    // sides have the same pieces, so flip the board when that isn't this position
+    bool symmetricBlackToMove = table->key == table->key2 && position.getSideToMove() == BLACK;
+    bool blackStronger = position.getMaterialKey() != table->key;
+    bool flip = symmetricBlackToMove || blackStronger;
+    int flipColor = flip ? TB_BLACK : 0;
+    int flipSquares = flip ? 56 : 0;
+    int stm = (flip ? 1 : 0) ^ position.getSideToMove();
+
+    int squares[MAX_PIECES];
+    int pieces[MAX_PIECES];
+    int size = 0;
+    int leadPawnsCount = 0;
+    uint64_t leadPawns = 0;
+    int tbFile = 0;
+
+    // With pawns there is a table for each file a-d the leading pawn can be on
+    if (table->hasPawns)
+    {
+        int leadPiece = table->get(0, 0)->pieces[0] ^ flipColor;
+        leadPawns = position.getBitboard(leadPiece & TB_BLACK ? BLACK_PAWNS : WHITE_PAWNS);
+        Bitboard(leadPawns).forEachBit([&](int s) { squares[size++] = s ^ flipSquares; });
+        leadPawnsCount = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCount, pawnsBefore));
+        tbFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    // DTZ tables hold one side to move only
+    if (type == DTZ)
+    {
+        int flags = table->get(stm, tbFile)->flags;
+        if ((flags & FLAG_STM) != stm && !(table->key == table->key2 && !table->hasPawns))
+        {
+            state = PROBE_CHANGE_STM;
+            return 0;
+        }
+    }
+
+    Bitboard(occupied ^ leadPawns).forEachBit([&](int s) {
+        squares[size] = s ^ flipSquares;
+        pieces[size++] = tbPiece(position, s) ^ flipColor;
+    });
+
+    PairsData* d = table->get(stm, tbFile);
+
+    // Put the pieces in the order the table numbers them in
+    for (int i = leadPawnsCount; i < size - 1; i++)
+    {
+        for (int j = i + 1; j < size; j++)
+        {
+            if (d->pieces[i] == pieces[j])
+            {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // Mirror so the leading piece is on files a-d
+    if (fileOf(squares[0]) > 3)
+    {
+        for (int i = 0; i < size; i++) squares[i] ^= 7;
+    }
+
+    uint64_t idx;
+    if (table->hasPawns)
+    {
+        idx = LeadPawnIdx[leadPawnsCount][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCount, pawnsBefore);
+        for (int i = 1; i < leadPawnsCount; i++) idx += Binomial[i][MapPawns[squares[i]]];
+    }
+    else
+    {
+        // Without pawns, also mirror the leading piece onto ranks 1-4 and below the diagonal
+        if (rankOf(squares[0]) > 3)
+        {
+            for (int i = 0; i < size; i++) squares[i] ^= 56;
+        }
+        for (int i = 0; i < d->groupLen[0]; i++)
+        {
+            if (!offA1H8(squares[i])) continue;
+            if (offA1H8(squares[i]) > 0)
+            {
+                for (int j = i; j < size; j++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (table->hasUniquePieces)
+        {
+            // The first three pieces together
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offA1H8(squares[0]))
+            {
+                idx = ((uint64_t)MapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            }
+            else if (offA1H8(squares[1]))
+            {
+                idx = ((uint64_t)6 * 63 + rankOf(squares[0]) * 28 + MapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            }
+            else if (offA1H8(squares[2]))
+            {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28 + (rankOf(squares[1]) - adjust1) * 28 + MapB1H1H7[squares[2]];
+            }
+            else
+            {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6 + (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2);
+            }
+        }
+        else
+        {
+            // Just the two kings
+            idx = MapKK[MapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The remaining groups, each numbered by the squares left once the earlier groups are placed
+    idx *= d->groupIdx[0];
+    int* groupSquares = squares + d->groupLen[0];
+    bool remainingPawns = table->hasPawns && table->pawnCount[1];
+    for (int next = 1; d->groupLen[next]; next++)
+    {
+        std::stable_sort(groupSquares, groupSquares + d->groupLen[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < d->groupLen[next]; i++)
+        {
+            int adjust = (int)std::count_if(squares, groupSquares, [&](int s) { return groupSquares[i] > s; });
+            n += Binomial[i + 1][groupSquares[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d->groupIdx[next];
+        groupSquares += d->groupLen[next];
+    }
+
+    return mapScore(*table, tbFile, decompressPairs(d, idx), wdl);
+}
+
+static inline bool isZeroing(const Position& position, const BitMove& move)
+{
+    int piece = position.pieceOn(move.from);
+    return move.isCapture() || piece == WHITE_PAWNS || piece == BLACK_PAWNS;
+}
+
+//
+// The tables don't know about en passant, and store "don't care" values for positions where a
+// capture is best, so captures (and with checkZeroing, pawn moves) are searched first and the
+// table is only trusted when none of them does better
+//
+static WDLScore search(Position& position, const MoveGenerator& moveGenerator, ProbeState& state, bool checkZeroing)
+{
+    MoveList moves;
+    moveGenerator.generateMoves(position, moves);
+    WDLScore bestValue = WDL_LOSS;
+    size_t moveCount = 0;
+
+    for (const BitMove& move : moves)
+    {
+        if (!move.isCapture() && (!checkZeroing || !isZeroing(position, move))) continue;
+        moveCount++;
+
+        position.makeMove(move);
+        WDLScore value = (WDLScore)-search(position, moveGenerator, state, false);
+        position.unmakeMove(move);
+        if (state == PROBE_FAIL) return WDL_DRAW;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+            if (value >= WDL_WIN)
+            {
+                state = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    // Every legal move was searched, so there is no need to trust the table
+    bool noMoreMoves = moveCount && moveCount == moves.size();
+    WDLScore value = bestValue;
+    if (!noMoreMoves)
+    {
+        value = (WDLScore)probeTable(position, WDL, state);
+        if (state == PROBE_FAIL) return WDL_DRAW;
+    }
+
+    if (bestValue >= value)
+    {
+        state = bestValue > WDL_DRAW || noMoreMoves ? PROBE_ZEROING_BEST_MOVE : PROBE_OK;
+        return bestValue;
+    }
+    state = PROBE_OK;
+    return value;
+}
+
+// DTZ of the move before a capture or pawn move that gives this result
+static int dtzBeforeZeroing(WDLScore wdl)
+{
+    return wdl == WDL_WIN ? 1 : wdl == WDL_CURSED_WIN ? 101 : wdl == WDL_BLESSED_LOSS ? -101 : wdl == WDL_LOSS ? -1 : 0;
+}
+
+static inline int signOf(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static int probeDTZ(Position& position, const MoveGenerator& moveGenerator, ProbeState& state)
+{
+    state = PROBE_OK;
+    WDLScore wdl = search(position, moveGenerator, state, true);
+    if (state == PROBE_FAIL || wdl == WDL_DRAW) return 0;
+    if (state == PROBE_ZEROING_BEST_MOVE) return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(position, DTZ, state, wdl);
+    if (state == PROBE_FAIL) return 0;
+    if (state != PROBE_CHANGE_STM) return (dtz + 100 * (wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN)) * signOf(wdl);
+
+    // The table has the other side to move, so look one move ahead for the best DTZ
+    MoveList moves;
+    moveGenerator.generateMoves(position, moves);
+    int minDTZ = 0xFFFF;
+    for (const BitMove& move : moves)
+    {
+        bool zeroing = isZeroing(position, move);
+        position.makeMove(move);
+
+        dtz = zeroing ? -dtzBeforeZeroing(search(position, moveGenerator, state, false)) : -probeDTZ(position, moveGenerator, state);
+
+        // A mating move has DTZ 1
+        if (dtz == 1 && position.inCheck())
+        {
+            MoveList replies;
+            moveGenerator.generateMoves(position, replies);
+            if (replies.empty()) minDTZ = 1;
+        }
+        if (!zeroing) dtz += signOf(dtz);
+        if (dtz < minDTZ && signOf(dtz) == signOf(wdl)) minDTZ = dtz;
+
+        position.unmakeMove(move);
+        if (state == PROBE_FAIL) return 0;
+    }
+    // No legal moves: mated
+    return minDTZ == 0xFFFF ? -1 : minDTZ;
+}
+
+//
+// Registering the tables
+//
+static const char PieceChars[] = " PNBRQK";
+
+// Material key of a table name such as "KRPvKR", with the pieces before the 'v' white
+static uint64_t materialKey(const std::string& name, bool swapColors)
+{
+    uint64_t key = 0;
+    int color = swapColors ? BLACK : WHITE;
+    for (char c : name)
+    {
+        if (c == 'v')
+        {
+            color ^= 1;
+            continue;
+        }
+        int type = (int)(strchr(PieceChars, c) - PieceChars);
+        key += 1ULL << (4 * ((color == WHITE ? WHITE_PAWNS : BLACK_PAWNS) + type - Pawn));
+    }
+    return key;
+}
+
+static std::string findFile(const std::vector<std::string>& directories, const std::string& name)
+{
+    for (const std::string& directory : directories)
+    {
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::path(directory) / name;
+        if (std::filesystem::exists(path, error)) return path.string();
+    }
+    return "";
+}
+
+static void add(const std::vector<std::string>& directories, const std::vector<int>& types)
+{
+    // The second king starts the black side: KRPvKR
+    std::string name;
+    for (size_t i = 0; i < types.size(); i++)
+    {
+        if (i > 0 && types[i] == King) name += 'v';
+        name += PieceChars[types[i]];
+    }
+
+    std::string file = name;
+    file += ".rtbw";
+    std::string wdlPath = findFile(directories, file);
+    if (wdlPath.empty()) return;
+    MaxPieces = std::max(MaxPieces, (int)types.size());
+
+    Tables.emplace_back(WDL);
+    Table& wdl = Tables.back();
+    wdl.path = wdlPath;
+    wdl.key = materialKey(name, false);
+    wdl.key2 = materialKey(name, true);
+    wdl.pieceCount = (int)types.size();
+
+    int pawns[2] = { 0, 0 };
+    int counts[2][King + 1] = {};
+    int color = WHITE;
+    for (char c : name)
+    {
+        if (c == 'v')
+        {
+            color = BLACK;
+            continue;
+        }
+        int type = (int)(strchr(PieceChars, c) - PieceChars);
+        counts[color][type]++;
+        if (type == Pawn) pawns[color]++;
+    }
+    wdl.hasPawns = pawns[WHITE] + pawns[BLACK] > 0;
+    for (int c = WHITE; c <= BLACK; c++)
+    {
+        for (int type = Pawn; type < King; type++)
+        {
+            if (counts[c][type] == 1) wdl.hasUniquePieces = true;
+        }
+    }
+    // The side with fewer pawns leads when both have some, it compresses better
+    bool whiteLeads = pawns[BLACK] == 0 || (pawns[WHITE] && pawns[BLACK] >= pawns[WHITE]);
+    wdl.pawnCount[0] = (uint8_t)(whiteLeads ? pawns[WHITE] : pawns[BLACK]);
+    wdl.pawnCount[1] = (uint8_t)(whiteLeads ? pawns[BLACK] : pawns[WHITE]);
+
+    Tables.emplace_back(DTZ);
+    Table& dtz = Tables.back();
+    file.back() = 'z';
+    dtz.path = findFile(directories, file);
+    dtz.key = wdl.key;
+    dtz.key2 = wdl.key2;
+    dtz.pieceCount = wdl.pieceCount;
+    dtz.hasPawns = wdl.hasPawns;
+    dtz.hasUniquePieces = wdl.hasUniquePieces;
+    dtz.pawnCount[0] = wdl.pawnCount[0];
+    dtz.pawnCount[1] = wdl.pawnCount[1];
+    // Without a DTZ file the table is simply never usable
+    if (dtz.path.empty())
+    {
+        dtz.ready = true;
+    }
+
+    Registry[wdl.key] = TableEntry{ &wdl, &dtz };
+    Registry[wdl.key2] = TableEntry{ &wdl, &dtz };
+}
+
+int init(const std::string& path)
+{
+    std::call_once(IndexTablesInitialized, initIndexTables);
+    Registry.clear();
+    Tables.clear();
+    MaxPieces = 0;
+    if (path.empty()) return 0;
+
+#ifdef _WIN32
+    const char separator = ';';
+#else
+    const char separator = ':';
+#endif
+    std::vector<std::string> directories;
+    size_t start = 0;
+    while (start <= path.size())
+    {
+        size_t end = path.find(separator, start);
+        if (end == std::string::npos) end = path.size();
+        if (end > start) directories.push_back(path.substr(start, end - start));
+        start = end + 1;
+    }
+
+    // Every combination of up to 7 pieces, stronger side first, pieces in decreasing order
+    for (int p1 = Pawn; p1 < King; p1++)
+    {
+        add(directories, { King, p1, King });
+        for (int p2 = Pawn; p2 <= p1; p2++)
+        {
+            add(directories, { King, p1, p2, King });
+            add(directories, { King, p1, King, p2 });
+            for (int p3 = Pawn; p3 < King; p3++) add(directories, { King, p1, p2, King, p3 });
+            for (int p3 = Pawn; p3 <= p2; p3++)
+            {
+                add(directories, { King, p1, p2, p3, King });
+                for (int p4 = Pawn; p4 <= p3; p4++)
+                {
+                    add(directories, { King, p1, p2, p3, p4, King });
+                    for (int p5 = Pawn; p5 <= p4; p5++) add(directories, { King, p1, p2, p3, p4, p5, King });
+                    for (int p5 = Pawn; p5 < King; p5++) add(directories, { King, p1, p2, p3, p4, King, p5 });
+                }
+                for (int p4 = Pawn; p4 < King; p4++)
+                {
+                    add(directories, { King, p1, p2, p3, King, p4 });
+                    for (int p5 = Pawn; p5 <= p4; p5++) add(directories, { King, p1, p2, p3, King, p4, p5 });
+                }
+            }
+            for (int p3 = Pawn; p3 <= p1; p3++)
+            {
+                for (int p4 = Pawn; p4 <= (p1 == p3 ? p2 : p3); p4++) add(directories, { King, p1, p2, King, p3, p4 });
+            }
+        }
+    }
+    return (int)Tables.size() / 2;
+}
+
+bool isAvailable()
+{
+    return true;
+}
+
+int maxPieces()
+{
+    return MaxPieces;
+}
+
+bool probeWDL(Position& position, const MoveGenerator& moveGenerator, WDLScore& wdl)
+{
+    ProbeState state = PROBE_OK;
+    wdl = search(position, moveGenerator, state, false);
+    return state != PROBE_FAIL;
+}
+
+bool probeDTZ(Position& position, const MoveGenerator& moveGenerator, int& dtz)
+{
+    ProbeState state;
+    dtz = probeDTZ(position, moveGenerator, state);
+    return state != PROBE_FAIL;
+}
+
+// Above any DTZ plus fifty move count, so a win the fifty move rule might spoil still ranks above
+// a draw and a loss it might save still ranks below one
+constexpr int MAX_DTZ = 1 << 18;
+
+//
+// Ranks every root move, higher being better: certain wins MAX_DTZ, wins the fifty move rule
+// might still spoil by how close they come to it, and losses the other way round. Only the moves
+// with the best rank are kept.
+//
+bool rankRootMoves(Position& position, const MoveGenerator& moveGenerator, std::vector<BitMove>& moves)
+{
+    moves.clear();
+    if (MaxPieces == 0) return false;
+
+    MoveList legal;
+    moveGenerator.generateMoves(position, legal);
+    if (legal.empty()) return false;
+
+    int halfmoveClock = position.getHalfmoveClock();
+    bool repeated = position.isRepetition();
+    std::vector<int> ranks;
+    bool useDTZ = true;
+
+    for (const BitMove& move : legal)
+    {
+        ProbeState state = PROBE_OK;
+        position.makeMove(move);
+        int dtz;
+        if (position.getHalfmoveClock() == 0)
+        {
+            dtz = dtzBeforeZeroing((WDLScore)-search(position, moveGenerator, state, false));
+        }
+        else if (position.isRepetition() || position.getHalfmoveClock() >= 100)
+        {
+            dtz = 0;
+        }
+        else
+        {
+            dtz = -probeDTZ(position, moveGenerator, state);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+        }
+        if (dtz == 2 && position.inCheck())
+        {
+            MoveList replies;
+            moveGenerator.generateMoves(position, replies);
+            if (replies.empty()) dtz = 1;
+        }
+        position.unmakeMove(move);
+        if (state == PROBE_FAIL)
+        {
+            useDTZ = false;
+            break;
+        }
+        ranks.push_back(dtz > 0 ? (dtz + halfmoveClock <= 99 && !repeated ? MAX_DTZ : MAX_DTZ - (dtz + halfmoveClock))
+                        : dtz < 0 ? (-dtz * 2 + halfmoveClock < 100 ? -MAX_DTZ : -MAX_DTZ + (-dtz + halfmoveClock))
+                        : 0);
+    }
+
+    // Without DTZ, only keep the moves with the best WDL result
+    if (!useDTZ)
+    {
+        static const int WDLRanks[] = { -MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ };
+        ranks.clear();
+        for (const BitMove& move : legal)
+        {
+            WDLScore wdl;
+            position.makeMove(move);
+            bool found = probeWDL(position, moveGenerator, wdl);
+            position.unmakeMove(move);
+            if (!found) return false;
+            ranks.push_back(WDLRanks[-wdl + 2]);
+        }
+    }
+
+    int best = *std::max_element(ranks.begin(), ranks.end());
+    for (size_t i = 0; i < legal.size(); i++)
+    {
+        if (ranks[i] == best) moves.push_back(legal[i]);
+    }
+    return true;
+}
+
+}
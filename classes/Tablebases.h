@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Position.h"
+#include "MoveGenerator.h"
+#include <string>
+#include <vector>
+
+//
+// Syzygy endgame tablebase probing. WDL files (.rtbw) hold whether each position is won, drawn
+// or lost, and are probed during the search; DTZ files (.rtbz) hold the distance to the next
+// capture or pawn move, and are probed at the root to pick moves that make progress.
+//
+// init only looks for file names. Each file is memory-mapped the first time a position needs it,
+// so startup stays fast and only the tables the game gets into take up memory. Mapped tables
+// are read-only, so any number of search threads can probe them at once.
+//
+// The prober (Tablebases.cpp) is ported from Stockfish and is GPLv3, so it is only built when
+// CMake is configured with -DSYZYGY=ON. Otherwise TablebasesDisabled.cpp stands in and never
+// finds any tables.
+//
+namespace Tablebases
+{
+    // Most pieces, kings included, any table file can have
+    constexpr int MAX_PIECES = 7;
+
+    // Result for the side to move. Cursed wins and blessed losses are wins and losses that take
+    // too long for the fifty move rule, so they are draws in play.
+    enum WDLScore
+    {
+        WDL_LOSS = -2,
+        WDL_BLESSED_LOSS = -1,
+        WDL_DRAW = 0,
+        WDL_CURSED_WIN = 1,
+        WDL_WIN = 2
+    };
+
+    // False when the build left the prober out, so init never finds anything
+    bool isAvailable();
+
+    // Registers every table found in path (directories separated by ':', or ';' on Windows),
+    // replacing any registered before, and returns how many there are. Not safe while a search
+    // is probing; call it before searching.
+    int init(const std::string& path);
+    // Most pieces, kings included, of any table found; 0 if there are none
+    int maxPieces();
+
+    // The tables assume nobody can castle and the fifty move count is zero, so callers check
+    // those first. Both return false if a table the position needs isn't there or can't be read.
+    bool probeWDL(Position& position, const MoveGenerator& moveGenerator, WDLScore& wdl);
+    // Plies to the next capture or pawn move that keeps the result, positive when winning,
+    // negative when losing and 0 for a draw
+    bool probeDTZ(Position& position, const MoveGenerator& moveGenerator, int& dtz);
+
+    // Fills moves with the legal root moves that keep the best result the tables give, ranked by
+    // DTZ and the fifty move count (or by WDL alone when the DTZ files are missing). Returns
+    // false, leaving moves empty, if the tables can't rank them.
+    bool rankRootMoves(Position& position, const MoveGenerator& moveGenerator, std::vector<BitMove>& moves);
+}
@@ -0,0 +1,41 @@
+#include "Tablebases.h"
+
+//
+// Stands in for Tablebases.cpp when the build leaves the Syzygy prober out (SYZYGY=OFF, the
+// default). There are never any tables, so the search doesn't probe and plays on as usual.
+//
+namespace Tablebases
+{
+
+bool isAvailable()
+{
+    return false;
+}
+
+int init(const std::string& path)
+{
+    return 0;
+}
+
+int maxPieces()
+{
+    return 0;
+}
+
+bool probeWDL(Position& position, const MoveGenerator& moveGenerator, WDLScore& wdl)
+{
+    return false;
+}
+
+bool probeDTZ(Position& position, const MoveGenerator& moveGenerator, int& dtz)
+{
+    return false;
+}
+
+bool rankRootMoves(Position& position, const MoveGenerator& moveGenerator, std::vector<BitMove>& moves)
+{
+    moves.clear();
+    return false;
+}
+
+}
@@ -0,0 +1,155 @@
+#include "TranspositionTable.h"
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <xmmintrin.h>
+#endif
+
+//
+// Packed entry layout, low to high bits:
+//   0-15  move (from 6, to 6, flags 4)
+//  16-31  score
+//  32-47  unused
+//  48-55  depth
+//  56-57  bound
+//  58-63  generation
+//
+uint64_t TranspositionTable::pack(const BitMove& move, int score, int depth, TTBound bound, uint8_t generation)
+{
+    uint64_t packedMove = move.toData();
+    uint64_t packedDepth = depth < 0 ? 0 : (depth > 255 ? 255 : depth);
+    return packedMove |
+           ((uint64_t)(uint16_t)(int16_t)score << 16) |
+           (packedDepth << 48) |
+           ((uint64_t)bound << 56) |
+           ((uint64_t)(generation & 63) << 58);
+}
+
+void TranspositionTable::unpack(uint64_t data, TTData& out)
+{
+    out.move = BitMove::fromData((uint16_t)data);
+    out.score = (int16_t)(uint16_t)(data >> 16);
+    out.depth = depthOf(data);
+    out.bound = (TTBound)((data >> 56) & 3);
+}
+
+TranspositionTable::TranspositionTable()
+    : _buckets(nullptr), _bucketCount(0), _generation(0)
+{
+    resize(16);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    delete[] _buckets;
+}
+
+void TranspositionTable::resize(size_t megabytes)
+{
+    // A power of two bucket count lets the index be a mask of the key
+    size_t bucketCount = 1;
+    while (bucketCount * 2 * sizeof(Bucket) <= megabytes * 1024 * 1024) bucketCount *= 2;
+
+    if (bucketCount != _bucketCount)
+    {
+        delete[] _buckets;
+        // Bucket is alignas(64), so this is a 64-byte aligned allocation
+        _buckets = new Bucket[bucketCount];
+        _bucketCount = bucketCount;
+    }
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i < _bucketCount; i++)
+    {
+        for (Entry& entry : _buckets[i].entries)
+        {
+            entry.keyXorData.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    _generation = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+    _generation = (_generation + 1) & 63;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& data) const
+{
+    Bucket& bucket = bucketFor(key);
+    for (const Entry& entry : bucket.entries)
+    {
+        uint64_t packed = entry.data.load(std::memory_order_relaxed);
+        if ((entry.keyXorData.load(std::memory_order_relaxed) ^ packed) == key && ((packed >> 56) & 3) != BOUND_NONE)
+        {
+            unpack(packed, data);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, const BitMove& move, int score, int depth, TTBound bound)
+{
+    Bucket& bucket = bucketFor(key);
+    Entry* replace = nullptr;
+    int replaceWorth = 0;
+
+    for (Entry& entry : bucket.entries)
+    {
+        uint64_t packed = entry.data.load(std::memory_order_relaxed);
+        uint64_t entryKey = entry.keyXorData.load(std::memory_order_relaxed) ^ packed;
+
+        if (entryKey == key)
+        {
+            // Same position: keep a deeper result from this search unless the new one is exact
+            if (bound != BOUND_EXACT && generationOf(packed) == _generation && depth + 3 < depthOf(packed)) return;
+            // Don't lose the best move just because this search didn't find one
+            BitMove keepMove = move;
+            if (move.isNull()) keepMove = BitMove::fromData((uint16_t)packed);
+            uint64_t data = pack(keepMove, score, depth, bound, _generation);
+            entry.data.store(data, std::memory_order_relaxed);
+            entry.keyXorData.store(key ^ data, std::memory_order_relaxed);
+            return;
+        }
+
+        // Otherwise replace the shallowest entry, counting each search of age as 8 plies of depth
+        int age = (_generation - generationOf(packed)) & 63;
+        int worth = ((packed >> 56) & 3) == BOUND_NONE ? -1000 : depthOf(packed) - 8 * age;
+        if (!replace || worth < replaceWorth)
+        {
+            replace = &entry;
+            replaceWorth = worth;
+        }
+    }
+
+    uint64_t data = pack(move, score, depth, bound, _generation);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->keyXorData.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::prefetch(uint64_t key) const
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    _mm_prefetch((const char*)&bucketFor(key), _MM_HINT_T0);
+#else
+    __builtin_prefetch(&bucketFor(key));
+#endif
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t samples = _bucketCount < 250 ? _bucketCount : 250;
+    int used = 0;
+    for (size_t i = 0; i < samples; i++)
+    {
+        for (const Entry& entry : _buckets[i].entries)
+        {
+            uint64_t packed = entry.data.load(std::memory_order_relaxed);
+            if (((packed >> 56) & 3) != BOUND_NONE && generationOf(packed) == _generation) used++;
+        }
+    }
+    return samples ? (int)(used * 1000 / (samples * 4)) : 0;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Bitboard.h"
+#include <atomic>
+#include <cstddef>
+
+enum TTBound : uint8_t
+{
+    BOUND_NONE,
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT
+};
+
+// What a search stores about a position
+struct TTData
+{
+    BitMove move;
+    int16_t score;
+    int depth;
+    TTBound bound;
+};
+
+//
+// Transposition table shared by every search thread. Entries are two 64-bit words, the packed
+// data and the key XORed with the data. A probe only accepts an entry when the two words still
+// XOR back to its key, so a torn read from a concurrent store is rejected instead of trusted,
+// and no locks are needed. Buckets hold four entries and are exactly one cache line.
+//
+class TranspositionTable
+{
+public:
+    TranspositionTable();
+    ~TranspositionTable();
+
+    // Reallocates the table to the given size in megabytes (rounded down to a power of two buckets) and clears it
+    void resize(size_t megabytes);
+    void clear();
+    // Ages the table so entries from earlier searches are replaced first
+    void newSearch();
+
+    bool probe(uint64_t key, TTData& data) const;
+    void store(uint64_t key, const BitMove& move, int score, int depth, TTBound bound);
+
+    // Lets the bucket for a key start loading before it is needed; the search calls it as soon as
+    // a move is made, so the bucket is on its way while the child node gets going
+    void prefetch(uint64_t key) const;
+
+    // Permill of sampled entries written during the current search, reported after each iteration
+    int hashfull() const;
+    size_t getSizeMB() const { return _bucketCount * sizeof(Bucket) / (1024 * 1024); }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[4];
+    };
+
+    static uint64_t pack(const BitMove& move, int score, int depth, TTBound bound, uint8_t generation);
+    static void unpack(uint64_t data, TTData& out);
+    static int depthOf(uint64_t data) { return (int)((data >> 48) & 0xFF); }
+    static uint8_t generationOf(uint64_t data) { return (uint8_t)(data >> 58); }
+
+    Bucket& bucketFor(uint64_t key) const { return _buckets[key & (_bucketCount - 1)]; }
+
+    Bucket* _buckets;
+    size_t _bucketCount;
+    uint8_t _generation;
+};
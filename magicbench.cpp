@@ -0,0 +1,215 @@
+//
+// Micro-benchmark for the slider attack lookups in MagicBitboards.h.
+//
+// usage: magicbench [lookups in millions]
+//
+// Times getRookAttacks/getBishopAttacks on the packed table against the layout they replaced,
+// 128 separate heap arrays reached through a pointer per square, on the same random squares and
+// occupancies, and checks that they all give the same attacks. The packed table is timed with
+// magic multiplication and, if this CPU has fast BMI2, with PEXT indexing as well.
+//
+// Then times whole-side slider attack maps: a lookup per piece against the set-wise Kogge-Stone
+// fills, scalar and (if this CPU has it) AVX2.
+//
+
+#include "classes/MagicBitboards.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// The old layout: one new[] block per square and piece type
+static uint64_t* HeapRAttacks[64];
+static uint64_t* HeapBAttacks[64];
+
+static void initHeapTables()
+{
+    for (int square = 0; square < 64; square++)
+    {
+        HeapRAttacks[square] = new uint64_t[RAttackSize[square]]();
+        HeapBAttacks[square] = new uint64_t[BAttackSize[square]]();
+
+        int bits = countOnes(RMasks[square]);
+        for (int i = 0; i < (1 << bits); i++)
+        {
+            uint64_t subset = indexToUint64(i, bits, RMasks[square]);
+            HeapRAttacks[square][(subset * RMagic[square]) >> RShifts[square]] = ratt(square, subset);
+        }
+        bits = countOnes(BMasks[square]);
+        for (int i = 0; i < (1 << bits); i++)
+        {
+            uint64_t subset = indexToUint64(i, bits, BMasks[square]);
+            HeapBAttacks[square][(subset * BMagic[square]) >> BShifts[square]] = batt(square, subset);
+        }
+    }
+}
+
+static inline uint64_t heapRookAttacks(int square, uint64_t occupied)
+{
+    occupied &= RMasks[square];
+    occupied *= RMagic[square];
+    occupied >>= RShifts[square];
+    return HeapRAttacks[square][occupied];
+}
+
+static inline uint64_t heapBishopAttacks(int square, uint64_t occupied)
+{
+    occupied &= BMasks[square];
+    occupied *= BMagic[square];
+    occupied >>= BShifts[square];
+    return HeapBAttacks[square][occupied];
+}
+
+// Runs lookup on every sample index, rounds times, and reports lookups per second
+template <typename Lookup>
+static uint64_t timeLookups(const char* name, size_t samples, int rounds, Lookup lookup)
+{
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < samples; i++) checksum += lookup(i);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double lookups = (double)rounds * samples;
+    printf("%-32s %8.1f M lookups/s\n", name, lookups / seconds / 1e6);
+    return checksum;
+}
+
+// Every square attacked by a set of sliders, one lookup per piece
+static uint64_t sliderAttacksPerPiece(uint64_t rooksQueens, uint64_t bishopsQueens, uint64_t occupied)
+{
+    uint64_t attacks = 0;
+    for (; rooksQueens; rooksQueens &= rooksQueens - 1) attacks |= getRookAttacks(getFirstBit(rooksQueens), occupied);
+    for (; bishopsQueens; bishopsQueens &= bishopsQueens - 1) attacks |= getBishopAttacks(getFirstBit(bishopsQueens), occupied);
+    return attacks;
+}
+
+int main(int argc, char** argv)
+{
+    int millions = argc > 1 ? atoi(argv[1]) : 100;
+    if (millions < 1)
+    {
+        fprintf(stderr, "usage: %s [lookups in millions]\n", argv[0]);
+        return 1;
+    }
+
+    selectSliderAttacks(false, false);
+    initHeapTables();
+
+    // Sparse random occupancies, roughly like a middlegame board
+    const size_t samples = 1 << 16;
+    std::vector<int> squares(samples);
+    std::vector<uint64_t> occupancies(samples);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    auto next = [&seed]()
+    {
+        seed ^= seed >> 12;
+        seed ^= seed << 25;
+        seed ^= seed >> 27;
+        return seed * 0x2545F4914F6CDD1DULL;
+    };
+    for (size_t i = 0; i < samples; i++)
+    {
+        squares[i] = (int)(next() & 63);
+        occupancies[i] = next() & next() & next();
+    }
+
+    // One side's sliders on each of those boards: two rooks, two bishops and a queen, as pieces allow
+    std::vector<uint64_t> rooksQueens(samples);
+    std::vector<uint64_t> bishopsQueens(samples);
+    for (size_t i = 0; i < samples; i++)
+    {
+        uint64_t pieces = occupancies[i];
+        uint64_t sliders[5] = {};
+        for (int piece = 0; piece < 5 && pieces; piece++)
+        {
+            int skip = (int)(next() % countOnes(pieces));
+            while (skip--) pieces &= pieces - 1;
+            sliders[piece] = pieces & (0 - pieces);
+            pieces = occupancies[i] & ~(sliders[0] | sliders[1] | sliders[2] | sliders[3] | sliders[4]);
+        }
+        rooksQueens[i] = sliders[0] | sliders[1] | sliders[4];
+        bishopsQueens[i] = sliders[2] | sliders[3] | sliders[4];
+    }
+
+    int rounds = (int)((uint64_t)millions * 1000000 / samples) + 1;
+#if defined(CPU_X86)
+    printf("Table size: %zu KB magic, %zu KB PEXT\n", sizeof(MagicAttackTable) / 1024,
+           (sizeof(RookPextAttackTable) + sizeof(BishopPextAttackTable)) / 1024);
+#else
+    printf("Table size: %zu KB magic\n", sizeof(MagicAttackTable) / 1024);
+#endif
+    printf("BMI2 PEXT: %s\n", cpuHasFastPext() ? "yes" : "no");
+    printf("AVX2: %s\n\n", cpuHasAvx2() ? "yes" : "no");
+
+    uint64_t checksum = 0;
+    checksum += timeLookups("rook, heap arrays", samples, rounds,
+        [&](size_t i) { return heapRookAttacks(squares[i], occupancies[i]); });
+    checksum += timeLookups("bishop, heap arrays", samples, rounds,
+        [&](size_t i) { return heapBishopAttacks(squares[i], occupancies[i]); });
+    checksum += timeLookups("queen, heap arrays", samples, rounds,
+        [&](size_t i) { return heapRookAttacks(squares[i], occupancies[i]) | heapBishopAttacks(squares[i], occupancies[i]); });
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            if (!cpuHasFastPext()) break;
+            selectSliderAttacks(true, false);
+        }
+
+        // Every layout must agree before its speed means anything
+        for (size_t i = 0; i < samples; i++)
+        {
+            if (getRookAttacks(squares[i], occupancies[i]) != heapRookAttacks(squares[i], occupancies[i]) ||
+                getBishopAttacks(squares[i], occupancies[i]) != heapBishopAttacks(squares[i], occupancies[i]))
+            {
+                fprintf(stderr, "attack mismatch on square %d with %s\n", squares[i], sliderAttackBackend());
+                return 1;
+            }
+        }
+
+        std::string backend = std::string(", packed ") + (pass == 0 ? "magic" : "PEXT");
+        checksum += timeLookups(("rook" + backend).c_str(), samples, rounds,
+            [&](size_t i) { return getRookAttacks(squares[i], occupancies[i]); });
+        checksum += timeLookups(("bishop" + backend).c_str(), samples, rounds,
+            [&](size_t i) { return getBishopAttacks(squares[i], occupancies[i]); });
+        checksum += timeLookups(("queen" + backend).c_str(), samples, rounds,
+            [&](size_t i) { return getQueenAttacks(squares[i], occupancies[i]); });
+        checksum += timeLookups(("all sliders" + backend).c_str(), samples, rounds,
+            [&](size_t i) { return sliderAttacksPerPiece(rooksQueens[i], bishopsQueens[i], occupancies[i]); });
+    }
+
+    printf("\n");
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1 && !cpuHasAvx2()) break;
+        selectSliderAttacks(false, pass == 1);
+
+        // Set-wise attack maps must match the lookups
+        for (size_t i = 0; i < samples; i++)
+        {
+            if (getSliderAttacksSetwise(rooksQueens[i], bishopsQueens[i], occupancies[i]) !=
+                sliderAttacksPerPiece(rooksQueens[i], bishopsQueens[i], occupancies[i]))
+            {
+                fprintf(stderr, "set-wise attack mismatch with %s\n", sliderAttackBackend());
+                return 1;
+            }
+        }
+
+        checksum += timeLookups(pass == 0 ? "all sliders, scalar Kogge-Stone" : "all sliders, AVX2 Kogge-Stone", samples, rounds,
+            [&](size_t i) { return getSliderAttacksSetwise(rooksQueens[i], bishopsQueens[i], occupancies[i]); });
+    }
+
+    // Printed so the lookups can't be optimised away
+    printf("\nchecksum %llx\n", (unsigned long long)checksum);
+
+    for (int square = 0; square < 64; square++)
+    {
+        delete[] HeapRAttacks[square];
+        delete[] HeapBAttacks[square];
+    }
+    return 0;
+}
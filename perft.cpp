@@ -0,0 +1,174 @@
+//
+// Headless perft harness for the chess move generator.
+//
+// usage: perft <depth> ["<fen>"] [--divide] [--hash <MB>]
+//
+// Counts the leaf nodes of the move generation tree from the given position (start position if
+// no FEN is given) and reports per-root-move counts, elapsed time and nodes per second.
+// Links only the bitboard code in classes/, no ImGui or GLFW.
+//
+
+#include "classes/MoveGenerator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+//
+// Cache of subtree node counts keyed by the position's Zobrist key and the remaining depth.
+// One entry per slot, always replaced.
+//
+class PerftCache
+{
+public:
+    PerftCache(size_t megabytes)
+        : _hits(0), _probes(0)
+    {
+        size_t count = megabytes * 1024 * 1024 / sizeof(Entry);
+        _table.assign(count, Entry{ 0, 0, 0 });
+    }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes)
+    {
+        _probes++;
+        const Entry& entry = _table[key % _table.size()];
+        if (entry.key != key || entry.depth != depth) return false;
+        _hits++;
+        nodes = entry.nodes;
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes)
+    {
+        _table[key % _table.size()] = Entry{ key, nodes, depth };
+    }
+
+    bool enabled() const { return !_table.empty(); }
+    size_t size() const { return _table.size(); }
+    uint64_t hits() const { return _hits; }
+    uint64_t probes() const { return _probes; }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint64_t nodes;
+        int depth;
+    };
+
+    std::vector<Entry> _table;
+    uint64_t _hits;
+    uint64_t _probes;
+};
+
+static MoveGenerator* generator = nullptr;
+static PerftCache* cache = nullptr;
+
+static uint64_t perft(Position& position, int depth)
+{
+    MoveList moves;
+    generator->generateMoves(position, moves);
+
+    // bulk counting, the leaves are never made
+    if (depth == 1) return moves.size();
+
+    uint64_t key = position.getZobristKey();
+    uint64_t cached;
+    if (cache->enabled() && cache->probe(key, depth, cached)) return cached;
+
+    uint64_t nodes = 0;
+    for (auto const & move : moves)
+    {
+        position.makeMove(move);
+        nodes += perft(position, depth - 1);
+        position.unmakeMove(move);
+    }
+
+    if (cache->enabled()) cache->store(key, depth, nodes);
+    return nodes;
+}
+
+int main(int argc, char** argv)
+{
+    int depth = 5;
+    std::string fen = StartFEN;
+    bool divide = false;
+    size_t hashMB = 64;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--divide") == 0)
+        {
+            divide = true;
+        }
+        else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc)
+        {
+            hashMB = (size_t)atoi(argv[++i]);
+        }
+        else if (positional == 0)
+        {
+            depth = atoi(argv[i]);
+            positional++;
+        }
+        else if (positional == 1)
+        {
+            fen = argv[i];
+            positional++;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s <depth> [\"<fen>\"] [--divide] [--hash <MB>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Position position;
+    if (depth < 1 || !position.setFEN(fen))
+    {
+        fprintf(stderr, "usage: %s <depth> [\"<fen>\"] [--divide] [--hash <MB>]\n", argv[0]);
+        return 1;
+    }
+
+    MoveGenerator moveGenerator;
+    PerftCache perftCache(hashMB);
+    generator = &moveGenerator;
+    cache = &perftCache;
+
+    printf("FEN: %s\nDepth: %d\nSlider attacks: %s\n\n", fen.c_str(), depth, MoveGenerator::sliderAttackBackend());
+
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t nodes = 0;
+    MoveList moves;
+    generator->generateMoves(position, moves);
+    for (auto const & move : moves)
+    {
+        uint64_t count = 1;
+        if (depth > 1)
+        {
+            position.makeMove(move);
+            count = perft(position, depth - 1);
+            position.unmakeMove(move);
+        }
+        if (divide) printf("%s: %llu\n", move.toString().c_str(), (unsigned long long)count);
+        nodes += count;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    if (divide) printf("\n");
+    printf("Nodes: %llu\n", (unsigned long long)nodes);
+    printf("Time: %.3f s\n", seconds);
+    printf("NPS: %.0f\n", seconds > 0 ? nodes / seconds : 0.0);
+    if (cache->enabled())
+    {
+        printf("Hash: %zu slots, %llu/%llu hits\n", cache->size(), (unsigned long long)cache->hits(), (unsigned long long)cache->probes());
+    }
+    return 0;
+}
@@ -0,0 +1,291 @@
+//
+// Headless check of the Syzygy tablebase probing code against known results.
+//
+// usage: tbcheck [<syzygy path>]
+//
+// Without a path, writes a small KNvK table of its own to a temporary directory, with every
+// position won for white, and checks that it is found under the right name and material key,
+// probed from both colours and with either side to move, and used to rank root moves. That needs
+// no downloaded files, so CTest always runs it.
+//
+// With a path, needs the 3-piece tables (KPvK, KRvK and KQvK at least) in the given directory. Probes a few
+// positions whose WDL and DTZ values are known, then every legal KPK, KRK and KQK position: the
+// WDL tables have to agree with the bitbases, which are worked out independently, on which side
+// wins, and the DTZ tables with the WDL tables on the sign. Prints each mismatch and exits with
+// 1 if there were any, so CTest can run it when resources/syzygy is there.
+//
+
+#include "classes/Bitbases.h"
+#include "classes/Tablebases.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct KnownResult
+{
+    const char* fen;
+    Tablebases::WDLScore wdl;
+    int dtz;
+};
+
+// Results for the side to move. DTZ is 1 when a mate or a zeroing move wins straight away.
+static const KnownResult KnownResults[] = {
+    // Qh8 and Rh8 mate
+    { "k7/8/1K6/8/8/8/7Q/8 w - - 0 1", Tablebases::WDL_WIN, 1 },
+    { "k7/8/1K6/8/8/8/8/7R w - - 0 1", Tablebases::WDL_WIN, 1 },
+    // The rook can't be taken
+    { "8/8/8/4k3/8/8/8/R3K3 b - - 0 1", Tablebases::WDL_LOSS, 0 },
+    // The queen is loose next to the black king
+    { "8/8/8/8/8/8/3kQ3/7K b - - 0 1", Tablebases::WDL_DRAW, 0 },
+    // e8=Q can't be stopped
+    { "8/4P3/8/8/8/8/k7/4K3 w - - 0 1", Tablebases::WDL_WIN, 1 },
+    // King on the sixth in front of its pawn wins whoever moves
+    { "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1", Tablebases::WDL_WIN, 0 },
+    { "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1", Tablebases::WDL_LOSS, 0 },
+    // Rook pawn with the defending king in the corner
+    { "7k/8/8/8/8/8/7P/7K w - - 0 1", Tablebases::WDL_DRAW, 0 },
+    { "7k/8/8/8/8/8/7P/7K b - - 0 1", Tablebases::WDL_DRAW, 0 },
+};
+
+static int checkKnownResults(const MoveGenerator& moveGenerator)
+{
+    int failures = 0;
+    for (const KnownResult& known : KnownResults)
+    {
+        Position position;
+        position.setFEN(known.fen);
+        Tablebases::WDLScore wdl;
+        int dtz;
+        if (!Tablebases::probeWDL(position, moveGenerator, wdl) || !Tablebases::probeDTZ(position, moveGenerator, dtz))
+        {
+            printf("%s: no table\n", known.fen);
+            failures++;
+            continue;
+        }
+        // A known DTZ of 0 only pins down the sign, through the WDL
+        bool dtzMatches = known.dtz != 0 ? dtz == known.dtz : (dtz > 0) - (dtz < 0) == (wdl > 0) - (wdl < 0);
+        if (wdl != known.wdl || !dtzMatches)
+        {
+            printf("%s: WDL %d DTZ %d, expected WDL %d DTZ %d\n", known.fen, (int)wdl, dtz, (int)known.wdl, known.dtz);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static const char PieceLetters[] = " PNBRQK";
+
+// Board squares, a1 = 0, with white's pieces in upper case
+static std::string makeFEN(int whiteKing, int blackKing, int pieceSquare, char piece, int sideToMove)
+{
+    std::string fen;
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for (int file = 0; file < 8; file++)
+        {
+            int square = rank * 8 + file;
+            char c = square == whiteKing ? 'K' : square == blackKing ? 'k' : square == pieceSquare ? piece : 0;
+            if (!c)
+            {
+                empty++;
+                continue;
+            }
+            if (empty) fen += (char)('0' + empty);
+            empty = 0;
+            fen += c;
+        }
+        if (empty) fen += (char)('0' + empty);
+        if (rank > 0) fen += '/';
+    }
+    fen += sideToMove == WHITE ? " w - - 0 1" : " b - - 0 1";
+    return fen;
+}
+
+//
+// Every legal position of ending with white as the strong side: the king that isn't to move
+// can't be in check. Both the bitbase and the WDL table say who wins, and the DTZ sign has to
+// follow the WDL.
+//
+static int checkEnding(const MoveGenerator& moveGenerator, Bitbases::Ending ending, int pieceType, size_t& positions)
+{
+    int failures = 0;
+    char piece = PieceLetters[pieceType];
+    for (int sideToMove = WHITE; sideToMove <= BLACK; sideToMove++)
+    {
+        for (int whiteKing = 0; whiteKing < 64; whiteKing++)
+        {
+            for (int blackKing = 0; blackKing < 64; blackKing++)
+            {
+                int fileDistance = std::abs((whiteKing & 7) - (blackKing & 7));
+                int rankDistance = std::abs((whiteKing >> 3) - (blackKing >> 3));
+                if (fileDistance <= 1 && rankDistance <= 1) continue;
+                for (int pieceSquare = 0; pieceSquare < 64; pieceSquare++)
+                {
+                    if (pieceSquare == whiteKing || pieceSquare == blackKing) continue;
+                    if (pieceType == Pawn && (pieceSquare < 8 || pieceSquare >= 56)) continue;
+
+                    Position position;
+                    position.setFEN(makeFEN(whiteKing, blackKing, pieceSquare, piece, sideToMove));
+                    int waiting = sideToMove == WHITE ? blackKing : whiteKing;
+                    if (position.getAttacks(sideToMove) & (1ULL << waiting)) continue;
+                    positions++;
+
+                    Tablebases::WDLScore wdl;
+                    int dtz;
+                    if (!Tablebases::probeWDL(position, moveGenerator, wdl) || !Tablebases::probeDTZ(position, moveGenerator, dtz))
+                    {
+                        printf("%s: no table\n", makeFEN(whiteKing, blackKing, pieceSquare, piece, sideToMove).c_str());
+                        return failures + 1;
+                    }
+                    bool tableWins = (sideToMove == WHITE ? wdl : -wdl) == Tablebases::WDL_WIN;
+                    bool bitbaseWins = Bitbases::probe(ending, WHITE, sideToMove, whiteKing, blackKing, pieceSquare);
+                    bool signMatches = (dtz > 0) - (dtz < 0) == (wdl > 0) - (wdl < 0);
+                    if (tableWins != bitbaseWins || !signMatches)
+                    {
+                        if (failures < 10)
+                        {
+                            printf("%s: WDL %d DTZ %d, bitbase %s\n", makeFEN(whiteKing, blackKing, pieceSquare, piece, sideToMove).c_str(),
+                                   (int)wdl, dtz, bitbaseWins ? "win" : "draw");
+                        }
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+// A KNvK WDL file holding a single value per side to move: won with white to move and lost with
+// black to move. The header gives the piece order, white king, knight, black king, for both
+// sides, then each side's table is flagged single valued, so there is no compressed data.
+static const unsigned char SyntheticKNvK[64] = {
+    0x71, 0xE8, 0x23, 0x5D, 0x01, 0x00, 0x66, 0x22, 0xEE, 0x00, 0x80, 0x04, 0x80, 0x00
+};
+
+struct SyntheticResult
+{
+    const char* fen;
+    bool found;
+    Tablebases::WDLScore wdl;
+};
+
+static const SyntheticResult SyntheticResults[] = {
+    { "8/8/8/8/8/2k5/8/N3K3 w - - 0 1", true, Tablebases::WDL_WIN },
+    { "8/8/8/8/8/2k5/8/N3K3 b - - 0 1", true, Tablebases::WDL_LOSS },
+    // Black has the knight: the same table, with the colours swapped
+    { "8/8/8/8/8/2K5/8/n3k3 b - - 0 1", true, Tablebases::WDL_WIN },
+    { "8/8/8/8/8/2K5/8/n3k3 w - - 0 1", true, Tablebases::WDL_LOSS },
+    // Bare kings need no table, and there is no KBvK table
+    { "8/8/8/8/8/2K5/8/4k3 w - - 0 1", true, Tablebases::WDL_DRAW },
+    { "8/8/8/8/8/2K5/8/B3k3 w - - 0 1", false, Tablebases::WDL_DRAW },
+};
+
+static int checkSynthetic()
+{
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(error) / "tbcheck-synthetic";
+    std::filesystem::create_directories(directory, error);
+    std::ofstream((directory / "KNvK.rtbw").string(), std::ios::binary).write((const char*)SyntheticKNvK, sizeof(SyntheticKNvK));
+
+    int failures = 0;
+    // The first directory doesn't exist, which init has to skip
+#ifdef _WIN32
+    int tables = Tablebases::init("tbcheck-missing;" + directory.string());
+#else
+    int tables = Tablebases::init("tbcheck-missing:" + directory.string());
+#endif
+    if (tables != 1 || Tablebases::maxPieces() != 3)
+    {
+        printf("Synthetic table: found %d tables up to %d pieces, expected 1 up to 3\n", tables, Tablebases::maxPieces());
+        failures++;
+    }
+
+    MoveGenerator moveGenerator;
+    for (const SyntheticResult& known : SyntheticResults)
+    {
+        Position position;
+        position.setFEN(known.fen);
+        Tablebases::WDLScore wdl = Tablebases::WDL_DRAW;
+        bool found = Tablebases::probeWDL(position, moveGenerator, wdl);
+        if (found != known.found || (found && wdl != known.wdl))
+        {
+            printf("%s: %s WDL %d, expected %s WDL %d\n", known.fen, found ? "found" : "no table", (int)wdl,
+                   known.found ? "found" : "no table", (int)known.wdl);
+            failures++;
+        }
+    }
+
+    // Without a DTZ file the root moves are ranked by WDL: only the king moves keep the knight
+    Position position;
+    position.setFEN(SyntheticResults[0].fen);
+    std::vector<BitMove> moves;
+    std::vector<std::string> names;
+    if (Tablebases::rankRootMoves(position, moveGenerator, moves))
+    {
+        for (const BitMove& move : moves) names.push_back(move.toString());
+    }
+    std::sort(names.begin(), names.end());
+    std::string kept;
+    for (const std::string& name : names)
+    {
+        if (!kept.empty()) kept += ' ';
+        kept += name;
+    }
+    if (kept != "e1d1 e1e2 e1f1 e1f2")
+    {
+        printf("%s: root moves kept \"%s\", expected \"e1d1 e1e2 e1f1 e1f2\"\n", SyntheticResults[0].fen, kept.c_str());
+        failures++;
+    }
+
+    // Forget the table before removing its file, which Windows won't do while it is mapped
+    Tablebases::init("");
+    std::filesystem::remove_all(directory, error);
+    printf("Synthetic table: %d failed\n", failures);
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 1) return checkSynthetic() ? 1 : 0;
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s [<syzygy path>]\n", argv[0]);
+        return 1;
+    }
+
+    int tables = Tablebases::init(argv[1]);
+    if (tables == 0)
+    {
+        fprintf(stderr, "no Syzygy tables in %s\n", argv[1]);
+        return 1;
+    }
+    Bitbases::init();
+    MoveGenerator moveGenerator;
+    printf("Tablebases: %d Syzygy tables up to %d pieces in %s\n\n", tables, Tablebases::maxPieces(), argv[1]);
+
+    auto start = std::chrono::steady_clock::now();
+    int failures = checkKnownResults(moveGenerator);
+    printf("Known results: %d failed\n", failures);
+
+    struct { const char* name; Bitbases::Ending ending; int pieceType; } endings[] = {
+        { "KPvK", Bitbases::KPK, Pawn }, { "KRvK", Bitbases::KRK, Rook }, { "KQvK", Bitbases::KQK, Queen }
+    };
+    for (const auto& ending : endings)
+    {
+        size_t positions = 0;
+        int endingFailures = checkEnding(moveGenerator, ending.ending, ending.pieceType, positions);
+        printf("%s: %zu positions, %d failed\n", ending.name, positions, endingFailures);
+        failures += endingFailures;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("\n%s in %.1f s\n", failures ? "FAILED" : "OK", seconds);
+    return failures ? 1 : 0;
+}